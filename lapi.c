@@ -361,9 +361,9 @@ LUA_API int lua_compare(lua_State *L, int index1, int index2, int op) {
             case LUA_OPLE: i = luaV_lessequal(L, o1, o2);
                 break;
             case LUA_OPTYPEOF:
-                i = luaV_typeof(L, o1, o2,NULL);
+                i = luaV_typeof(L, o1, o2);
                 break;
-            case LUA_OPINSTANCEOF: i = luaV_instanceof(L, o1, o2,NULL);
+            case LUA_OPINSTANCEOF: i = luaV_instanceof(L, o1, o2);
                 break;
             default: api_check(L, 0, "invalid option");
         }
@@ -14,6 +14,7 @@
 #include <limits.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "lua.h"
 
@@ -816,6 +817,14 @@ void luaK_dischargevars(FuncState *fs, expdesc *e) {
             e->k = VRELOC;
             break;
         }
+        case VINDEXSLOT: {
+            int slot = e->u.ind.slot;
+            freereg(fs, e->u.ind.t);
+            e->u.info = luaK_codeABC(fs, OP_GETSLOT, 0, e->u.ind.t, e->u.ind.idx);
+            luaK_code(fs, CREATE_Ax(OP_EXTRAARG, slot)); //字段在它的类里的槽位
+            e->k = VRELOC;
+            break;
+        }
         case VINDEXED: {
             freeregs(fs, e->u.ind.t, e->u.ind.idx);
             e->u.info = luaK_codeABC(fs, OP_GETTABLE, 0, e->u.ind.t, e->u.ind.idx);
@@ -1097,6 +1106,11 @@ void luaK_storevar(FuncState *fs, expdesc *var, expdesc *ex) {
             codeABRK(fs, OP_SETFIELD, var->u.ind.t, var->u.ind.idx, ex);
             break;
         }
+        case VINDEXSLOT: {
+            codeABRK(fs, OP_SETSLOT, var->u.ind.t, var->u.ind.idx, ex);
+            luaK_code(fs, CREATE_Ax(OP_EXTRAARG, var->u.ind.slot)); //字段在它的类里的槽位
+            break;
+        }
         case VINDEXED: {
             codeABRK(fs, OP_SETTABLE, var->u.ind.t, var->u.ind.idx, ex);
             break;
@@ -1693,10 +1707,13 @@ void luaK_infix(FuncState *fs, BinOpr op, expdesc *v) {
             luaK_goiffalse(fs, v); /* go ahead only if 'v' is false */
             break;
         }
-        case OPR_CONCAT:
+        case OPR_CONCAT: {
+            luaK_exp2nextreg(fs, v); /* operand must be on the stack */
+            break;
+        }
         case OPR_TYPEOF:
         case OPR_INSTANCEOF: {
-            luaK_exp2nextreg(fs, v); /* operand must be on the stack */
+            luaK_exp2anyreg(fs, v); //局部变量不用再拷一份
             break;
         }
         case OPR_ADD:
@@ -1760,7 +1777,24 @@ static void codeconcat(FuncState *fs, expdesc *e1, expdesc *e2, int line) {
     }
 }
 
+//字面量类型名对应的类型标签，两种userdata都叫"userdata"，取LUA_TUSERDATA，不是类型名的返回LUA_NUMTYPES
+static int typenametag(TString *name) {
+    int tag = LUA_NUMTYPES;
+    for (int t = 0; t < LUA_NUMTYPES; t++) {
+        if (strcmp(ttypename(t), getstr(name)) == 0) tag = t;
+    }
+    return tag;
+}
+
 static void codeof(FuncState *fs, BinOpr opr, expdesc *e1, expdesc *e2) {
+    if (opr == OPR_TYPEOF && e2->k == VKSTR) {
+        //右边是字面量类型名：直接比较类型标签，不用把字符串放进寄存器
+        int r1 = luaK_exp2anyreg(fs, e1);
+        freeexp(fs, e1);
+        e1->u.info = condjump(fs, OP_TESTTYPE, r1, typenametag(e2->u.strval), 0, 1);
+        e1->k = VJMP;
+        return;
+    }
     int r1 = luaK_exp2anyreg(fs, e1);
     int r2 = luaK_exp2anyreg(fs, e2);
     freeexps(fs, e1, e2);
@@ -595,7 +595,7 @@ static const char *getobjname (const Proto *p, int lastpc, int reg,
         *name = "integer index";
         return "field";
       }
-      case OP_GETFIELD: {
+      case OP_GETFIELD: case OP_GETSLOT: {
         int k = GETARG_C(i);  /* key index */
         kname(p, k, name);
         return isEnv(p, lastpc, i, 0);
@@ -631,10 +631,11 @@ static const char *funcnamefromcode (lua_State *L, const Proto *p,
     }
     /* other instructions can do calls through metamethods */
     case OP_SELF: case OP_GETTABUP: case OP_GETTABLE:
-    case OP_GETI: case OP_GETFIELD:
+    case OP_GETI: case OP_GETFIELD: case OP_GETSLOT:
       tm = TM_INDEX;
       break;
     case OP_SETTABUP: case OP_SETTABLE: case OP_SETI: case OP_SETFIELD:
+    case OP_SETSLOT:
       tm = TM_NEWINDEX;
       break;
     case OP_MMBIN: case OP_MMBINI: case OP_MMBINK: {
@@ -32,6 +32,7 @@
 #include "lundump.h"
 #include "lvm.h"
 #include "lzio.h"
+#include "lobjudata.h"
 
 
 
@@ -549,10 +550,25 @@ l_sinline int precallC (lua_State *L, StkId func, int nresults,
 */
 int luaD_pretailcall (lua_State *L, CallInfo *ci, StkId func,
                                     int narg1, int delta) {
+  Udata *objself = NULL;  /* receiver, if calling an ObjLua method */
  retry:
   switch (ttypetag(s2v(func))) {
-    case LUA_VCCL:  /* C closure */
-      return precallC(L, func, LUA_MULTRET, clCvalue(s2v(func))->f);
+    case LUA_VCCL: {  /* C closure */
+      lua_CFunction f = clCvalue(s2v(func))->f;
+      if (Objudata_isproxy(f)) {  /* ObjLua method proxy? */
+        ptrdiff_t funcr = savestack(L, func);
+        StkId bound = Objudata_bind(L, func, LUA_MULTRET);
+        if (bound == NULL)  /* already done in place? */
+          return cast_int(L->top.p - restorestack(L, funcr));
+        if (!ttisLclosure(s2v(bound)))  /* left to the proxy's own body? */
+          return precallC(L, bound, LUA_MULTRET, f);
+        func = bound;  /* reuse this frame for the method */
+        objself = uvalue(s2v(func + 1));
+        narg1 += 2;  /* self and super */
+        goto retry;
+      }
+      return precallC(L, func, LUA_MULTRET, f);
+    }
     case LUA_VLCF:  /* light C function */
       return precallC(L, func, LUA_MULTRET, fvalue(s2v(func)));
     case LUA_VLCL: {  /* Lua function */
@@ -571,6 +587,11 @@ int luaD_pretailcall (lua_State *L, CallInfo *ci, StkId func,
       lua_assert(ci->top.p <= L->stack_last.p);
       ci->u.l.savedpc = p->code;  /* starting point */
       ci->callstatus |= CIST_TAIL;
+      ci->callstatus &= ~CIST_OBJMETHOD;  /* callee does not inherit class access */
+      if (objself != NULL) {
+        ci->callstatus |= CIST_OBJMETHOD;
+        ci->u.l.objself = objself;
+      }
       L->top.p = func + narg1;  /* set top */
       return -1;
     }
@@ -595,9 +616,19 @@ int luaD_pretailcall (lua_State *L, CallInfo *ci, StkId func,
 CallInfo *luaD_precall (lua_State *L, StkId func, int nresults) {
  retry:
   switch (ttypetag(s2v(func))) {
-    case LUA_VCCL:  /* C closure */
-      precallC(L, func, nresults, clCvalue(s2v(func))->f);
+    case LUA_VCCL: {  /* C closure */
+      lua_CFunction f = clCvalue(s2v(func))->f;
+      if (Objudata_isproxy(f)) {  /* ObjLua method proxy? */
+        StkId bound = Objudata_bind(L, func, nresults);
+        if (bound == NULL)  /* already done in place? */
+          return NULL;
+        if (ttisLclosure(s2v(bound)))  /* push the method frame directly */
+          return Objudata_precall(L, bound, nresults);
+        func = bound;  /* else run the proxy's own body */
+      }
+      precallC(L, func, nresults, f);
       return NULL;
+    }
     case LUA_VLCF:  /* light C function */
       precallC(L, func, nresults, fvalue(s2v(func)));
       return NULL;
@@ -640,7 +671,7 @@ l_sinline void ccall (lua_State *L, StkId func, int nResults, l_uint32 inc) {
     luaE_checkcstack(L);
   }
   if ((ci = luaD_precall(L, func, nResults)) != NULL) {  /* Lua function? */
-    ci->callstatus = CIST_FRESH;  /* mark that it is a "fresh" execute */
+    ci->callstatus |= CIST_FRESH;  /* mark that it is a "fresh" execute */
     luaV_execute(L, ci);  /* call it */
   }
   L->nCcalls -= inc;
@@ -659,6 +659,7 @@ static int traverseLclosure(global_State *g, LClosure *cl) {
 */
 static int traversethread(global_State *g, lua_State *th) {
     UpVal *uv;
+    CallInfo *ci;
     StkId o = th->stack.p;
     if (isold(th) || g->gcstate == GCSpropagate)
         linkgclist(th, g->grayagain); /* insert into 'grayagain' list */
@@ -670,6 +671,9 @@ static int traversethread(global_State *g, lua_State *th) {
         markvalue(g, s2v(o));
     for (uv = th->openupval; uv != NULL; uv = uv->u.open.next)
         markobject(g, uv); /* open upvalues cannot be collected */
+    for (ci = th->ci; ci != NULL; ci = ci->previous) /* ObjLua method receivers */
+        if (ci->callstatus & CIST_OBJMETHOD)
+            markobject(g, ci->u.l.objself);
     if (g->gcstate == GCSatomic) {
         /* final traversal? */
         if (!g->gcemergency)
@@ -117,4 +117,7 @@ static const void *const disptab[NUM_OPCODES] = {
 &&L_OP_CKCABSTRACT,
 &&L_OP_TYPEOF,
 &&L_OP_INSTANCEOF,
+&&L_OP_GETSLOT,
+&&L_OP_SETSLOT,
+&&L_OP_TESTTYPE,
 };
@@ -434,6 +434,9 @@ typedef struct TString {
 #define pvalue(o)	check_exp(ttislightuserdata(o), val_(o).p)
 #define uvalue(o)	check_exp(ttisfulluserdata(o), gco2u(val_(o).gc))
 
+/* full userdata holding an ObjLua class or object */
+#define ttisobjlua(o)	(ttisfulluserdata(o) && uvalue(o)->objlua)
+
 #define pvalueraw(v)	((v).p)
 
 #define setpvalue(obj,x) \
@@ -458,6 +461,7 @@ typedef union UValue {
 */
 typedef struct Udata {
   CommonHeader;
+  lu_byte objlua;  /* ObjLua class/object (1) or super view (2) */
   unsigned short nuvalue;  /* number of user values */
   size_t len;  /* number of bytes */
   struct Table *metatable;
@@ -477,6 +481,7 @@ typedef struct Udata {
 */
 typedef struct Udata0 {
   CommonHeader;
+  lu_byte objlua;  /* ObjLua class/object (1) or super view (2) */
   unsigned short nuvalue;  /* number of user values */
   size_t len;  /* number of bytes */
   struct Table *metatable;
@@ -544,6 +549,22 @@ typedef struct AbsLineInfo {
   int line;
 } AbsLineInfo;
 
+/*
+** ObjLua inline cache for one OP_GETFIELD/OP_SETFIELD/OP_SELF/OP_GETSLOT/OP_SETSLOT
+** (see 'Objudata_icget' in lobjudata.c)
+*/
+typedef struct ObjInlineCache {
+  size_t classid;  /* id of the receiver's class; 0 means empty */
+  struct LuaObjUData *level;  /* class declaring the field */
+  size_t slot;  /* index of the field in its class */
+  lu_byte kind;  /* field or method */
+  lu_byte isclass;  /* receiver is the class itself */
+  lu_byte access;  /* access decision the entry was filled with */
+  int levelofs;  /* OP_GETSLOT/OP_SETSLOT: declaring level minus receiver */
+  struct Table *mt;  /* OP_GETSLOT/OP_SETSLOT: metatable the entry was filled with */
+} ObjInlineCache;
+
+
 /*
 ** Function Prototypes
 */
@@ -569,6 +590,7 @@ typedef struct Proto {
   AbsLineInfo *abslineinfo;  /* idem */
   LocVar *locvars;  /* information about local variables (debug information) */
   TString  *source;  /* used for debug information */
+  ObjInlineCache *objic;  /* ObjLua inline caches, one per instruction */
   GCObject *gclist;
 } Proto;
 
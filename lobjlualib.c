@@ -10,29 +10,20 @@
 #include "lvm.h"
 #include "lstring.h"
 #include "ldebug.h"
-
-static inline TValue *getObjLuaWeakTable(lua_State *L) {
-    TValue *ObjLuaWeakTable;
-    if (!luaV_fastget(L, &G(L)->l_registry, luaS_newliteral(L, OBJLUA_WEAK_TABLE), ObjLuaWeakTable,
-                      (TValue *) luaH_getshortstr))
-        luaG_runerror(L, "'f_luaopen' not worked: <"OBJLUA_WEAK_TABLE"> is not initialized");
-    return ObjLuaWeakTable;
-}
+#include "lgc.h"
 
 LUA_API int objlua_getSuper(lua_State *L) {
     luaL_checktype(L, 1, LUA_TUSERDATA);
     TValue *o = index2value(L, 1);
-    const TValue *ObjLuaWeakTable = getObjLuaWeakTable(L);
-    const TValue *slot;
-    if (!luaV_fastget(L, ObjLuaWeakTable, o, slot, luaH_get) && ttistrue(slot)) {
+    if (!ttisobjlua(o)) {
         lua_pushnil(L);
         return 1;
     }
-    const LuaObjUData *classOrObj = lua_touserdata(L, 1);
+    const LuaObjUData *classOrObj = Objudata_get(uvalue(o));
     lua_pushnil(L);
     if (classOrObj->super) {
         o = index2value(L, -1);
-        setuvalue(L, o, classOrObj->super->udata);
+        setuvalue(L, o, Objudata_udata(L, classOrObj->super));
         return 1;
     }
     return 1;
@@ -41,13 +32,11 @@ LUA_API int objlua_getSuper(lua_State *L) {
 LUA_API int objlua_getClass(lua_State *L) {
     luaL_checktype(L, 1, LUA_TUSERDATA);
     TValue *o = index2value(L, 1);
-    const TValue *ObjLuaWeakTable = getObjLuaWeakTable(L);
-    const TValue *slot;
-    if (!luaV_fastget(L, ObjLuaWeakTable, o, slot, luaH_get) && ttistrue(slot)) {
+    if (!ttisobjlua(o)) {
         lua_pushnil(L);
         return 1;
     }
-    const LuaObjUData *classOrObj = lua_touserdata(L, 1);
+    const LuaObjUData *classOrObj = Objudata_get(uvalue(o));
     lua_pushnil(L);
     o = index2value(L, -1);
     setuvalue(L, o, classOrObj->classholder->udata);
@@ -57,13 +46,11 @@ LUA_API int objlua_getClass(lua_State *L) {
 LUA_API int objlua_isClass(lua_State *L) {
     luaL_checktype(L, 1, LUA_TUSERDATA);
     const TValue *o = index2value(L, 1);
-    const TValue *ObjLuaWeakTable = getObjLuaWeakTable(L);
-    const TValue *slot;
-    if (!luaV_fastget(L, ObjLuaWeakTable, o, slot, luaH_get) && ttistrue(slot)) {
+    if (!ttisobjlua(o)) {
         lua_pushboolean(L, 0);
         return 1;
     }
-    const LuaObjUData *classOrObj = lua_touserdata(L, 1);
+    const LuaObjUData *classOrObj = Objudata_get(uvalue(o));
     lua_pushboolean(L, classOrObj->is_class);
     return 1;
 }
@@ -71,13 +58,11 @@ LUA_API int objlua_isClass(lua_State *L) {
 LUA_API int objlua_isObject(lua_State *L) {
     luaL_checktype(L, 1, LUA_TUSERDATA);
     const TValue *o = index2value(L, 1);
-    const TValue *ObjLuaWeakTable = getObjLuaWeakTable(L);
-    const TValue *slot;
-    if (!luaV_fastget(L, ObjLuaWeakTable, o, slot, luaH_get) && ttistrue(slot)) {
+    if (!ttisobjlua(o)) {
         lua_pushboolean(L, 0);
         return 1;
     }
-    const LuaObjUData *classOrObj = lua_touserdata(L, 1);
+    const LuaObjUData *classOrObj = Objudata_get(uvalue(o));
     lua_pushboolean(L, !classOrObj->is_class);
     return 1;
 }
@@ -93,13 +78,11 @@ enum {
 static int objlua_commonGet(lua_State *L, int flag, int declard) {
     luaL_checktype(L, 1, LUA_TUSERDATA);
     const TValue *o = index2value(L, 1);
-    const TValue *ObjLuaWeakTable = getObjLuaWeakTable(L);
-    const TValue *slot;
-    if (!luaV_fastget(L, ObjLuaWeakTable, o, slot, luaH_get) && ttistrue(slot)) {
+    if (!ttisobjlua(o)) {
         lua_newtable(L);
         return 1;
     }
-    const LuaObjUData *classOrObj = lua_touserdata(L, 1);
+    const LuaObjUData *classOrObj = Objudata_get(uvalue(o));
     lua_newtable(L);
     int idx = 0;
     switch (flag) {
@@ -252,6 +235,28 @@ LUA_API int objlua_isNoWrap(lua_State *L) {
     return objlua_commonAccessFlag(L, LUAOBJ_ACCESS_NOWRAP);
 }
 
+//方法看@final注解，类或者对象看它的类是不是@final类
+LUA_API int objlua_isFinal(lua_State *L) {
+    if (lua_type(L, 1) == LUA_TLIGHTUSERDATA) return objlua_commonAccessFlag(L, LUAOBJ_ACCESS_FINAL);
+    luaL_checktype(L, 1, LUA_TUSERDATA);
+    const TValue *o = index2value(L, 1);
+    lua_pushboolean(L, ttisobjlua(o) && Objudata_get(uvalue(o))->is_final);
+    return 1;
+}
+
+LUA_API int objlua_isMemo(lua_State *L) {
+    return objlua_commonAccessFlag(L, LUAOBJ_ACCESS_MEMO);
+}
+
+//扔掉@memo方法缓存的结果：传对象是它自己的，传类是类以及它和子类所有对象的
+LUA_API int objlua_clearMemo(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TUSERDATA);
+    const TValue *o = index2value(L, 1);
+    luaL_argcheck(L, ttisobjlua(o), 1, "class or object expected");
+    Objudata_clearmemo(L, Objudata_get(uvalue(o)));
+    return 0;
+}
+
 LUA_API int objlua_isMethod(lua_State *L) {
     return objlua_commonAccessFlag(L, LUAOBJ_ACCESS_ISMETHOD);
 }
@@ -263,11 +268,9 @@ LUA_API int objlua_isField(lua_State *L) {
 LUA_API int objlua_getName(lua_State *L) {
     if (lua_type(L, 1) == LUA_TUSERDATA) {
         TValue *o = index2value(L, 1);
-        const TValue *ObjLuaWeakTable = getObjLuaWeakTable(L);
-        const TValue *slot;
-        if (!luaV_fastget(L, ObjLuaWeakTable, o, slot, luaH_get) && ttistrue(slot))
+        if (!ttisobjlua(o))
             goto badtype_ret;
-        const LuaObjUData *classOrObj = lua_touserdata(L, 1);
+        const LuaObjUData *classOrObj = Objudata_get(uvalue(o));
         lua_pushnil(L);
         if (classOrObj->name) {
             o = index2value(L, -1);
@@ -333,6 +336,9 @@ LUA_API int objlua_hotfixMethod(lua_State *L) {
         lua_pushvalue(L, 2); //R4
         lua_rawseti(L, -2, ++CLASS_GCIDX); //R3
         method->func = clLvalue(o);
+        //换上去的函数不一定还是平凡存取方法，按新函数重新判断
+        method->flags &= ~(LUAOBJ_ACCESS_GETTER | LUAOBJ_ACCESS_SETTER);
+        method->flags |= Objudata_trivial(method->func->p);
         lua_pushboolean(L, 1);
         return 1;
     }
@@ -341,31 +347,36 @@ LUA_API int objlua_hotfixMethod(lua_State *L) {
 }
 
 LUA_API int objlua_getMethodInit(lua_State *L) {
-    CallInfo *lastCall = L->ci->previous; //lua
-    lastCall = lastCall->previous; //wrap
+    LuaObjUData *classobj = Objudata_methodinit(L->ci->previous); //lua
     lua_settop(L, 0);
     lua_pushnil(L);
     lua_pushnil(L);
-    if (lastCall && ttypetag(s2v(lastCall->func.p)) == LUA_VCCL) {
-        CClosure *wrapcall = clCvalue(s2v(lastCall->func.p));
-        if ((Objudata_MethodWrapCall == wrapcall->f ||
-             Objudata_metaProxy == wrapcall->f)
-            && wrapcall->nupvalues >= 2) {
-            TValue *selfTV = &wrapcall->upvalue[0];
-            LuaObjUData *classobj = (LuaObjUData *) getudatamem(uvalue(selfTV));
-            setobj2n(L, index2value(L, 1), selfTV);
-            if (classobj->super) setuvalue(L, index2value(L, 2), classobj->super->udata);
-        }
+    if (classobj) {
+        setuvalue(L, index2value(L, 1), classobj->udata);
+        if (classobj->super) setuvalue(L, index2value(L, 2), Objudata_udata(L, classobj->super));
     }
     return 2;
 }
 
+//可选的对象参数：非static字段的值在对象自己身上，不给就是字段描述上的（初始值）
+static LuaObjUData *objlua_fieldholder(lua_State *L, int idx) {
+    if (lua_isnoneornil(L, idx)) return NULL;
+    luaL_checktype(L, idx, LUA_TUSERDATA);
+    const TValue *o = index2value(L, idx);
+    if (!ttisobjlua(o))
+        luaL_argerror(L, idx, "not a class or object");
+    return Objudata_get(uvalue(o));
+}
+
 LUA_API int objlua_getFieldValue(lua_State *L) {
     luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-    const LuaObjField *field = lua_touserdata(L, 1);
+    LuaObjField *field = lua_touserdata(L, 1);
+    LuaObjUData *holder = objlua_fieldholder(L, 2);
     lua_pushnil(L);
     if (field->flags & LUAOBJ_ACCESS_ISFIELD) {
-        setobj2n(L, index2value(L, -1), &field->udata->uv[OBJLUA_UV_fields].uv);
+        Udata *owner;
+        TValue *v = Objudata_fieldvalue(holder, field, &owner);
+        if (v) setobj2n(L, index2value(L, -1), v);
     }
     return 1;
 }
@@ -373,9 +384,15 @@ LUA_API int objlua_getFieldValue(lua_State *L) {
 LUA_API int objlua_setFieldValue(lua_State *L) {
     luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
     luaL_checkany(L, 2);
-    const LuaObjField *field = lua_touserdata(L, 1);
+    LuaObjField *field = lua_touserdata(L, 1);
+    LuaObjUData *holder = objlua_fieldholder(L, 3);
     if (field->flags & LUAOBJ_ACCESS_ISFIELD) {
-        setobj2n(L, &field->udata->uv[OBJLUA_UV_fields].uv, index2value(L, 2));
+        Udata *owner;
+        TValue *v = Objudata_fieldvalue(holder, field, &owner);
+        if (v) {
+            setobj(L, v, index2value(L, 2));
+            luaC_barrierback(L, obj2gco(owner), index2value(L, 2));
+        }
     }
     return 0;
 }
@@ -449,6 +466,28 @@ LUA_API int objlua_hasField(lua_State *L) {
     return objlua_hasXX(L, objlua_getFields);
 }
 
+//开启类的对象池：被回收或者release的对象最多留n个给下次new复用，n为0关闭
+LUA_API int objlua_pool(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TUSERDATA);
+    const TValue *o = index2value(L, 1);
+    if (!ttisobjlua(o) || !Objudata_get(uvalue(o))->is_class)
+        luaL_argerror(L, 1, "not a class");
+    lua_Integer n = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, n >= 0, 2, "pool size must not be negative");
+    Objudata_setpool(L, Objudata_get(uvalue(o)), (size_t) n);
+    return 0;
+}
+
+//对象不再使用了，直接放回它的类的对象池（之后不能再用它），放进去了返回true
+LUA_API int objlua_release(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TUSERDATA);
+    const TValue *o = index2value(L, 1);
+    if (!ttisobjlua(o) || uvalue(o)->objlua != OBJLUA_UDATA || Objudata_get(uvalue(o))->is_class)
+        luaL_argerror(L, 1, "not an object");
+    lua_pushboolean(L, Objudata_release(L, Objudata_get(uvalue(o))));
+    return 1;
+}
+
 static const luaL_Reg objluaLib[] = {
         {"getSuper",                   objlua_getSuper},
         {"getClass",                   objlua_getClass},
@@ -472,6 +511,9 @@ static const luaL_Reg objluaLib[] = {
         {"isAbstract",                 objlua_isAbstract},
         {"isConstructor",              objlua_isConstructor},
         {"isNoWrap",                   objlua_isNoWrap},
+        {"isFinal",                    objlua_isFinal},
+        {"isMemo",                     objlua_isMemo},
+        {"clearMemo",                  objlua_clearMemo},
         {"isMethod",                   objlua_isMethod},
         {"isField",                    objlua_isField},
         {"getName",                    objlua_getName},
@@ -485,6 +527,8 @@ static const luaL_Reg objluaLib[] = {
         {"getMethodArgTypes",          objlua_getMethodArgTypes},
         {"hasMethod",                  objlua_hasMethod},
         {"hasField",                   objlua_hasField},
+        {"pool",                       objlua_pool},
+        {"release",                    objlua_release},
         {NULL, NULL}
 };
 
@@ -15,25 +15,12 @@
 #include "ldebug.h"
 #include "lvm.h"
 #include "ltable.h"
+#include "ltm.h"
+#include "lgc.h"
+#include "lmem.h"
+#include "lopcodes.h"
 #include "lobjudata.h"
 
-int Objudata_init(lua_State *L) {
-    int ctop = lua_gettop(L);
-    if (!luaL_getsubtable(L, LUA_REGISTRYINDEX, OBJLUA_WEAK_TABLE)) {
-        //ctop+1
-        //初始化一个k弱表(类/对象都在这里，不在这里说明只是普通userdata)
-        lua_newtable(L); //ctop+2
-        lua_pushliteral(L, "k"); //ctop+3
-        lua_setfield(L, -2, "__mode"); //ctop+2
-        lua_setmetatable(L, -2); //ctop+1
-        TString *ts = luaS_new(L, OBJLUA_WEAK_TABLE);
-        luaC_fix(L, obj2gco(ts)); //OBJLUA_WEEK_TABLE永不回收，方便我直接luaS_new(L, OBJLUA_WEAK_TABLE)
-    }
-    // Table* ObjLuaWeakTable = hvalue(s2v(L->top.p-1));
-    // luaH_resize(L,ObjLuaWeakTable, 1,160);
-    lua_settop(L, ctop); //完成初始化了就结束了，这么做为了方便不用luacall方法直接函数调用，不污染运行栈(f_luaopen里启动运行的)
-}
-
 /*
  * 由于解释器以及部分执行时一定以及必然强制产生一些中长期不在堆栈没有Lua范围引用的仅存活在C的堆栈的情况，
  * 为了保证原定架构可以正确定义，这里把对应OP执行通过闭包转换为一个新的一段运行栈区域，
@@ -87,68 +74,183 @@ static int ObjudataMT__setup(lua_State *L, int idx);
 // }
 
 
-CClosure *RunAtPrepare(lua_State *L, const int nupvals, const lua_CFunction f) {
-    CClosure *cl = luaF_newCclosure(L, nupvals);
-    cl->f = f;
-    for (int n = 0; n < nupvals; n++)
-        setnilvalue(&cl->upvalue[n]);
-    return cl;
+/*
+ * 成员索引：每个类定义时维护 名字->成员 的哈希表，
+ * 字段存fields下标（对象的fields与类的一一对应，所以对象直接共享类的索引），
+ * 方法/元方法存同名重载链的表头（LuaObjMethod->overload串起来，保持定义顺序），
+ * 这样查找不再对fields/methods/metamethods逐个luaS_streq
+ */
+static const TValue ObjIndex_absentkey = {ABSTKEYCONSTANT};
+
+static const TValue *ObjIndex_get(Table *index, TString *name) {
+    if (index == NULL || name == NULL) return &ObjIndex_absentkey;
+    return luaH_getstr(index, name);
+}
+
+static void ObjIndex_set(lua_State *L, Table *index, TString *name, const TValue *v) {
+    lua_pushnil(L);
+    sethvalue(L, index2value(L, -1), index);
+    lua_pushnil(L);
+    setsvalue(L, index2value(L, -1), name);
+    lua_pushnil(L);
+    setobj(L, index2value(L, -1), v);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+}
+
+static LuaObjField *ObjIndex_field(LuaObjUData *classOrObj, TString *name) {
+    const TValue *o = ObjIndex_get(classOrObj->fieldindex, name);
+    if (!ttisinteger(o)) return NULL;
+    return classOrObj->fields[ivalue(o)];
+}
+
+static LuaObjMethod *ObjIndex_methods(Table *index, TString *name) {
+    const TValue *o = ObjIndex_get(index, name);
+    if (!ttislightuserdata(o)) return NULL;
+    return (LuaObjMethod *) pvalue(o);
+}
+
+//给重载链表头或者类挂一个重载解析缓存，udata挂在owner的GC表里
+static OverloadCache *ObjOverload_newcache(lua_State *L, Udata *owner) {
+    OverloadCache *cache = lua_newuserdatauv(L, sizeof(OverloadCache), 0); //R1
+    for (int i = 0; i < OBJLUA_OVERLOAD_CACHESIZE; ++i)
+        cache->entries[i].argc = -1;
+    cache->next = 0;
+    lua_pushnil(L); //R2
+    setuvalue(L, index2value(L, -1), owner); //R2
+    lua_getiuservalue(L, -1, OBJLUA_UV_gc + 1); //R3
+    int GCIDX = luaL_len(L, -1); //R3
+    lua_pushvalue(L, -3); //R4
+    lua_rawseti(L, -2, ++GCIDX); //R3
+    lua_pop(L, 3); //R0
+    return cache;
+}
+
+//把方法挂到重载链尾部，第一个同名的直接作为表头登记
+static void ObjIndex_addmethod(lua_State *L, Table *index, LuaObjMethod *method) {
+    LuaObjMethod *head = ObjIndex_methods(index, method->name);
+    method->overload = NULL;
+    if (head) {
+        LuaObjMethod *tail = head;
+        while (tail->overload) tail = tail->overload;
+        tail->overload = method;
+    } else {
+        TValue v;
+        setpvalue(&v, method);
+        ObjIndex_set(L, index, method->name, &v);
+    }
+}
+
+//clazz这一层的重载链表头，有重载或者有类型限制才需要解析缓存（argtypes在加进链表之后才登记，所以等类体结束再建）
+static void ObjOverload_initcaches(lua_State *L, Table *index, LuaObjMethod **methods, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        LuaObjMethod *head = methods[i];
+        if (head->ocache || ObjIndex_methods(index, head->name) != head) continue;
+        if (head->overload || head->argtypes) head->ocache = ObjOverload_newcache(L, head->udata);
+    }
+}
+
+//名字为name的方法（meta为真时是元方法）在clazz这一层的重载链表头，VM做类定义检查时用
+LuaObjMethod *Objudata_overloads(LuaObjUData *clazz, int meta, TString *name) {
+    return ObjIndex_methods(meta ? clazz->metaindex : clazz->methodindex, name);
+}
+
+/*
+ * 类定义相关指令的C实现（RunAtOP_*）直接当轻量C函数调用，参数依次放在当前Lua帧的寄存器之上，
+ * 不用每条指令分配一个C闭包，返回值（nresults个）留在栈顶
+ */
+void RunAtCall(lua_State *L, lua_CFunction f, const TValue *args, int nargs, int nresults) {
+    L->top.p = L->ci->top.p;
+    luaD_checkstack(L, nargs + 1);
+    StkId func = L->top.p;
+    setfvalue(s2v(func), f);
+    for (int n = 0; n < nargs; n++)
+        setobj2s(L, func + 1 + n, &args[n]);
+    L->top.p = func + 1 + nargs;
+    luaD_call(L, func, nresults);
 }
 
 /*
  * case OP_DEFCLASS
- * uv1:类的名字
- * uv2:父类（nil为无父类）
+ * arg1:类的名字
+ * arg2:父类（nil为无父类）
  * ret:类
  */
 int RunAtOP_DEFCLASS(lua_State *L) {
     int GCIDX = 0;
-    lua_getfield(L, LUA_REGISTRYINDEX, OBJLUA_WEAK_TABLE); //R1
-    //为了防止左脚踩右脚，出现本质clazz->super = clazz，要后注册clazz
-    LuaObjUData *clazz = lua_newuserdatauv(L, sizeof(LuaObjUData), LuaObjUDataUpValueMinSize); //R2
-    clazz->udata = uvalue(index2value(L, -1)); //R2
+    //为了防止左脚踩右脚，出现本质clazz->super = clazz，要后标记clazz
+    LuaObjUData *clazz = lua_newuserdatauv(L, sizeof(LuaObjUData), LuaObjUDataUpValueMinSize); //R3
+    clazz->udata = uvalue(index2value(L, -1)); //R3
     // 预先准备元表
-    lua_newtable(L); //R3
-    ObjudataMT__setup(L, 3); //R3
-    lua_setmetatable(L, -2); //R2
+    lua_newtable(L); //R4
+    ObjudataMT__setup(L, 4); //R4
+    lua_setmetatable(L, -2); //R3
     //创建GC表（承担后续对象GC挂载任务）
-    lua_newtable(L); //R3
-    lua_pushvalue(L, -1); //R4
-    lua_setiuservalue(L, 2, OBJLUA_UV_gc + 1); //R3
-    if (lua_isnil(L, lua_upvalueindex(2))) {
-        //R3
+    lua_newtable(L); //R4
+    lua_pushvalue(L, -1); //R5
+    lua_setiuservalue(L, 3, OBJLUA_UV_gc + 1); //R4
+    if (lua_isnil(L, 2)) {
+        //R4
         //无父类
-        clazz->super = NULL; //R3
+        clazz->super = NULL; //R4
     } else {
         //有父类
-        lua_pushvalue(L, lua_upvalueindex(2)); //R4
-        lua_rawget(L, -4); //R4
-        if (!lua_toboolean(L, -1)) luaG_runerror(L, "bad super class: not registered"); //R3
-        lua_pop(L, 1); //R3
-        LuaObjUData *superClass = lua_touserdata(L, lua_upvalueindex(2)); //R3
-        if (!superClass->is_class) luaG_runerror(L, "bad super class: not a class"); //R3
-        clazz->super = superClass; //R3
+        if (!ttisobjlua(index2value(L, 2))) luaG_runerror(L, "bad super class: not registered");
+        LuaObjUData *superClass = Objudata_get(uvalue(index2value(L, 2))); //R4
+        if (!superClass->is_class) luaG_runerror(L, "bad super class: not a class"); //R4
+        if (superClass->is_final) luaG_runerror(L, "bad super class: final class cannot be extended"); //R4
+        clazz->super = superClass; //R4
         //把父类绑定到现在定义的类的GC表里
-        lua_pushvalue(L, lua_upvalueindex(2)); //R4
-        lua_rawseti(L, -2, ++GCIDX); //R3
+        lua_pushvalue(L, 2); //R5
+        lua_rawseti(L, -2, ++GCIDX); //R4
     }
-    if (lua_type(L, lua_upvalueindex(1)) == LUA_TSTRING) {
-        //R3
+    if (lua_type(L, 1) == LUA_TSTRING) {
+        //R4
         //有名字
-        lua_pushvalue(L, lua_upvalueindex(1)); //R4
-        TString *ts = tsvalue(index2value(L, -1)); //R4
-        clazz->name = ts; //R4
+        lua_pushvalue(L, 1); //R5
+        TString *ts = tsvalue(index2value(L, -1)); //R5
+        clazz->name = ts; //R5
         //把父类绑定到现在定义的类的GC表里
-        lua_rawseti(L, -2, ++GCIDX); //R3
+        lua_rawseti(L, -2, ++GCIDX); //R4
     } else {
         //无名字
         clazz->name = NULL;
     }
+    //祖先表，同样挂在GC表里
+    clazz->depth = clazz->super ? clazz->super->depth + 1 : 0;
+    clazz->display = lua_newuserdatauv(L, sizeof(LuaObjUData *) * (clazz->depth + 1), 0); //R5
+    if (clazz->super)
+        memcpy(clazz->display, clazz->super->display, sizeof(LuaObjUData *) * clazz->depth);
+    clazz->display[clazz->depth] = clazz;
+    lua_rawseti(L, -2, ++GCIDX); //R4
+    //成员索引表，同样挂在GC表里
+    lua_newtable(L); //R5
+    clazz->fieldindex = hvalue(index2value(L, -1)); //R5
+    lua_rawseti(L, -2, ++GCIDX); //R4
+    lua_newtable(L); //R5
+    clazz->methodindex = hvalue(index2value(L, -1)); //R5
+    lua_rawseti(L, -2, ++GCIDX); //R4
+    lua_newtable(L); //R5
+    clazz->metaindex = hvalue(index2value(L, -1)); //R5
+    lua_rawseti(L, -2, ++GCIDX); //R4
+    clazz->vtable = NULL; //类体结束时才建立
+    clazz->fieldinit = NULL; //同上
+    clazz->classid = ++G(L)->objclassid;
+    clazz->ctorcache = NULL;
+    clazz->pool = NULL;
+    clazz->npooled = clazz->poolmax = 0;
+    clazz->inpool = 0;
+    clazz->boundcache[0] = clazz->boundcache[1] = NULL;
+    clazz->nmemo = 0;
+    clazz->memogen = clazz->memoepoch = 0;
     clazz->classholder = clazz; //类就是自己，这时候就不需要挂载GC了
     clazz->is_class = 1;
+    clazz->is_final = 0; //OP_CKCABSTRACT时才定下
     clazz->size_constructors = 0;
     clazz->size_metamethods = 0;
     clazz->size_fields = 0;
+    clazz->nslots = 0;
+    clazz->constinit = NULL;
     clazz->constructors = NULL;
     clazz->metamethods = NULL;
     clazz->fields = NULL;
@@ -156,266 +258,333 @@ int RunAtOP_DEFCLASS(lua_State *L) {
     clazz->methods = NULL;
     clazz->size_abstractmethods = 0;
     clazz->abstractmethods = NULL;
-    //完成了，可以注册了
-    lua_pushvalue(L, 2); //R4 键
-    lua_pushboolean(L, 1); //R5 值
-    lua_rawset(L, -5); //R3
+    clazz->outer = clazz;
+    clazz->slotbase = 0;
+    clazz->viewslot = -1;
+    //完成了，可以标记了
+    clazz->udata->objlua = OBJLUA_UDATA;
     //回到clazz位置，返回1个（也就是clazz）
-    lua_settop(L, 2); //R0
+    lua_settop(L, 3); //R3
     return 1;
 }
 
 /*
  * case OP_DEFFIELD
- * uv1:类
- * uv2:字段名
- * uv3:字段值
- * uv4:字段访问标志
- * uv5:字段是否初始化
+ * arg1:类
+ * arg2:字段名
+ * arg3:字段值
+ * arg4:字段访问标志
+ * arg5:字段是否初始化
  */
 int RunAtOP_DEFFIELD(lua_State *L) {
     int GCIDX = 0;
-    lua_getfield(L, LUA_REGISTRYINDEX, OBJLUA_WEAK_TABLE); //R1
     //首先看看类是不是合法的
-    lua_pushvalue(L, lua_upvalueindex(1)); //R2
-    lua_rawget(L, -2); //R2
-    if (!lua_toboolean(L, -1)) luaG_runerror(L, "define class field failed: not a class in "OBJLUA_WEAK_TABLE); //R2
-    lua_pop(L, 1); //R1
-    LuaObjUData *clazz = lua_touserdata(L,lua_upvalueindex(1)); //R1
+    if (!ttisobjlua(index2value(L, 1)))
+        luaG_runerror(L, "define class field failed: not a class");
+    LuaObjUData *clazz = lua_touserdata(L,1); //R5
     if (!clazz->is_class) luaG_runerror(L, "define class field failed: target is object");
-    const TValue *nameT = index2value(L,lua_upvalueindex(2)); //R1
-    if (lua_type(L, lua_upvalueindex(2)) != LUA_TSTRING)
-        luaG_runerror(L, "define class field failed: field name must be string"); //R1
+    const TValue *nameT = index2value(L,2); //R5
+    if (lua_type(L, 2) != LUA_TSTRING)
+        luaG_runerror(L, "define class field failed: field name must be string"); //R5
     int deffield_access = 1;
     //不能定义父类存在的字段
     LuaObjUData *super = clazz;
     TString *nameS = tsvalue(nameT);
     while (super) {
-        for (int j = 0; j < super->size_fields; ++j) {
-            LuaObjField *super_field = super->fields[j];
-            if (luaS_streq(super_field->name, nameS)) {
-                deffield_access = 0;
-                break;
-            }
+        if (ObjIndex_field(super, nameS)) {
+            deffield_access = 0;
+            break;
         }
         super = super->super;
     }
     if (!deffield_access)
         luaG_runerror(L, "define class field failed: field '%s' already exists in '%s' class",
                       getstr(tsvalue(nameT)), super == clazz ? "self" : "super");
-    LuaObjField *field = (LuaObjField *) lua_newuserdatauv(L, sizeof(LuaObjField), LuaObjFieldUpValueMinSize); //R2
+    LuaObjField *field = (LuaObjField *) lua_newuserdatauv(L, sizeof(LuaObjField), LuaObjFieldUpValueMinSize); //R6
     field->name = tsvalue(nameT);
     field->self = clazz;
-    LuaObjAccessFlags flags = lua_tointeger(L, lua_upvalueindex(4)); //R2
+    LuaObjAccessFlags flags = lua_tointeger(L, 4); //R6
     field->flags = flags;
     field->initconst = 0;
-    field->udata = uvalue(index2value(L, -1)); //R2
+    field->udata = uvalue(index2value(L, -1)); //R6
     //创建GC表（承担后续对象GC挂载任务）
-    lua_newtable(L); //R3
-    lua_pushvalue(L, -1); //R4
-    lua_setiuservalue(L, -3, OBJLUA_UV_gc + 1); //R3
+    lua_newtable(L); //R7
+    lua_pushvalue(L, -1); //R8
+    lua_setiuservalue(L, -3, OBJLUA_UV_gc + 1); //R7
     //字段名GC在字段的GC表里
-    lua_pushvalue(L, lua_upvalueindex(2)); //R4
-    lua_rawseti(L, -2, ++GCIDX); //R3
+    lua_pushvalue(L, 2); //R8
+    lua_rawseti(L, -2, ++GCIDX); //R7
     //同样的，绑定关系的类也需要绑定在GC表里
-    lua_pushvalue(L, lua_upvalueindex(1)); //R4
-    lua_rawseti(L, -2, ++GCIDX); //R3
+    lua_pushvalue(L, 1); //R8
+    lua_rawseti(L, -2, ++GCIDX); //R7
     //字段自己本身应该绑在clazz的GC表里，并且添加进列表，这一步进行封装使用
-    lua_pushcfunction(L, Objudata_DefField); //R4 需要三个参数:clazz,field,deffield
-    lua_pushvalue(L,lua_upvalueindex(1)); //R5 clazz
-    lua_pushvalue(L, -4); //R6 field
-    lua_pushboolean(L, 1); //R7
-    lua_call(L, 3, 0); //R3
-    if (lua_toboolean(L, lua_upvalueindex(5))) {
-        //R3
-        //R3
+    lua_pushcfunction(L, Objudata_DefField); //R8 需要三个参数:clazz,field,deffield
+    lua_pushvalue(L,1); //R9 clazz
+    lua_pushvalue(L, -4); //R10 field
+    lua_pushboolean(L, 1); //R11
+    lua_call(L, 3, 0); //R7
+    if (lua_toboolean(L, 5)) {
+        //R7
+        //R7
         //需要设置初始值
-        lua_pushvalue(L, lua_upvalueindex(3)); //R4
-        lua_setiuservalue(L, -3, OBJLUA_UV_fields + 1); //R3
+        lua_pushvalue(L, 3); //R8
+        lua_setiuservalue(L, -3, OBJLUA_UV_fields + 1); //R7
         //const的禁止再赋值
         if (flags & LUAOBJ_ACCESS_CONST)field->initconst = 1;
     } else {
-        lua_pushnil(L); //R4
-        lua_setiuservalue(L, -3, OBJLUA_UV_fields + 1); //R3
+        lua_pushnil(L); //R8
+        lua_setiuservalue(L, -3, OBJLUA_UV_fields + 1); //R7
     }
     return 0;
 }
 
 /*
  * case OP_DEFMETHODARGTYPE
- * uv1:方法
- * uv2:类型（字符串或者userdata<LuaObjUData>）
- * uv3:类型模式
- * uv4:定义的偏移量
+ * arg1:方法
+ * arg2:类型（字符串或者userdata<LuaObjUData>）
+ * arg3:类型模式
+ * arg4:定义的偏移量
  */
 int RunAtOP_DEFMETHODARGTYPE(lua_State *L) {
-    if (lua_type(L, lua_upvalueindex(1)) != LUA_TUSERDATA) //R0
+    if (lua_type(L, 1) != LUA_TUSERDATA) //R4
         luaG_runerror(L, "method arg type define: it just works on userdata<LuaObjMethod>");
-    const LuaObjMethod *method = (LuaObjMethod *) lua_touserdata(L,lua_upvalueindex(1)); //R0
-    const int arg_pos = lua_tointeger(L, lua_upvalueindex(4)); //R0
+    const LuaObjMethod *method = (LuaObjMethod *) lua_touserdata(L,1); //R4
+    const int arg_pos = lua_tointeger(L, 4); //R4
     MethodArgType *mtype = method->argtypes[arg_pos];
-    const int typeflags = lua_tointeger(L, lua_upvalueindex(3)); //R0
+    const int typeflags = lua_tointeger(L, 3); //R4
     if (typeflags == 0) {
         mtype->none = 1;
     } else if (typeflags & TYPEMASK_is_vararg) {
         mtype->is_vararg = 1;
     } else if (typeflags & TYPEMASK_is_typemode) {
-        if (lua_type(L, lua_upvalueindex(2)) != LUA_TSTRING) //R0
+        if (lua_type(L, 2) != LUA_TSTRING) //R4
             luaG_runerror(L, "method arg type define: typemode need string");
         mtype->is_typemode = 1;
         //绑定GC到MethodArgType
-        lua_pushnil(L); //R1
-        setuvalue(L, index2value(L,-1), mtype->udata); //R1
-        lua_pushvalue(L, lua_upvalueindex(2)); //R2
-        mtype->type = tsvalue(index2value(L, -1)); //R2
-        lua_setiuservalue(L, -2, OBJLUA_UV_gc + 1); //R1
+        lua_pushnil(L); //R5
+        setuvalue(L, index2value(L,-1), mtype->udata); //R5
+        lua_pushvalue(L, 2); //R6
+        mtype->type = tsvalue(index2value(L, -1)); //R6
+        lua_setiuservalue(L, -2, OBJLUA_UV_gc + 1); //R5
         lua_pop(L, 1);
-        // lua_setiuservalue(L, lua_upvalueindex(1), OBJLUA_UV_gc+1); //R0
+        //类型名解析成ttype，userdata这种一个名字对应多个的都算上，不认识的名字什么都匹配不上
+        mtype->typemask = 0;
+        for (int t = LUA_TNONE; t < LUA_NUMTYPES; ++t) {
+            if (strcmp(ttypename(t), getstr(mtype->type)) == 0)
+                mtype->typemask |= 1 << (t + 1);
+        }
+        // lua_setiuservalue(L, 1, OBJLUA_UV_gc+1); //R4
     } else if (typeflags & TYPEMASK_is_classmode) {
-        if (lua_type(L, lua_upvalueindex(2)) != LUA_TUSERDATA) {
-            //R0
+        if (lua_type(L, 2) != LUA_TUSERDATA) {
+            //R4
         badclassmode:;
             luaG_runerror(L, "method arg type define: classmode need userdata<LuaObjUData>");
         }
-        lua_getfield(L, LUA_REGISTRYINDEX, OBJLUA_WEAK_TABLE); //R1
         //是不是合法的
-        lua_pushvalue(L, lua_upvalueindex(2)); //R2
-        lua_rawget(L, -2); //R2
-        if (!lua_toboolean(L, -1)) goto badclassmode; //R2
-        lua_pop(L, 2); //R0
+        if (!ttisobjlua(index2value(L, 2))) goto badclassmode; //R4
         mtype->is_classmode = 1;
         //绑定GC到MethodArgType
-        lua_pushnil(L); //R1
-        setuvalue(L, index2value(L,-1), mtype->udata); //R1
-        lua_pushvalue(L, lua_upvalueindex(2)); //R2
-        mtype->clazz = (LuaObjUData *) lua_touserdata(L, -1); //R2
-        lua_setiuservalue(L, -2, OBJLUA_UV_gc + 1); //R1
+        lua_pushnil(L); //R5
+        setuvalue(L, index2value(L,-1), mtype->udata); //R5
+        lua_pushvalue(L, 2); //R6
+        mtype->clazz = Objudata_get(uvalue(index2value(L, -1))); //R6
+        lua_setiuservalue(L, -2, OBJLUA_UV_gc + 1); //R5
         lua_pop(L, 1);
-        // lua_setiuservalue(L, lua_upvalueindex(1), OBJLUA_UV_gc+1); //R0
+        // lua_setiuservalue(L, 1, OBJLUA_UV_gc+1); //R4
     } else luaG_runerror(L, "method arg type define: unknown typeflags");
     return 0;
 }
 
 /*
  * case OP_DEFMETHOD
- * uv1:类
- * uv2:方法名
- * uv3:方法实现函数
- * uv4:方法访问标志
- * uv5:nargs
+ * arg1:类
+ * arg2:方法名
+ * arg3:方法实现函数
+ * arg4:方法访问标志
+ * arg5:nargs
  * ret:方法对象（userdata<LuaObjMethod>）
  */
 int RunAtOP_DEFMETHOD(lua_State *L) {
     int GCIDX = 0;
-    lua_getfield(L, LUA_REGISTRYINDEX, OBJLUA_WEAK_TABLE); //R1
     //首先看看类是不是合法的
-    lua_pushvalue(L, lua_upvalueindex(1)); //R2
-    lua_rawget(L, -2); //R2
-    if (!lua_toboolean(L, -1)) luaG_runerror(L, "define class method failed: not a class in "OBJLUA_WEAK_TABLE); //R2
-    lua_pop(L, 2); //R0
-    LuaObjUData *clazz = lua_touserdata(L, lua_upvalueindex(1)); //R0
+    if (!ttisobjlua(index2value(L, 1)))
+        luaG_runerror(L, "define class method failed: not a class"); //R5
+    LuaObjUData *clazz = lua_touserdata(L, 1); //R5
     if (!clazz->is_class) luaG_runerror(L, "define class method failed: target is object");
-    if (lua_type(L, lua_upvalueindex(2)) != LUA_TSTRING) //R0
+    if (lua_type(L, 2) != LUA_TSTRING) //R5
         luaG_runerror(L, "define class method failed: method name must be string");
-    LuaObjMethod *method = lua_newuserdatauv(L, sizeof(LuaObjMethod), LuaObjMethodUpValueMinSize); //R1
-    method->udata = uvalue(index2value(L, -1)); //R1
-    const LuaObjAccessFlags flags = lua_tointeger(L, lua_upvalueindex(4)); //R1
+    LuaObjMethod *method = lua_newuserdatauv(L, sizeof(LuaObjMethod), LuaObjMethodUpValueMinSize); //R6
+    method->udata = uvalue(index2value(L, -1)); //R6
+    const LuaObjAccessFlags flags = lua_tointeger(L, 4); //R6
     method->flags = flags;
     method->self = clazz;
-    method->name = tsvalue(index2value(L, lua_upvalueindex(2))); //R1
+    method->name = tsvalue(index2value(L, 2)); //R6
     if (flags & LUAOBJ_ACCESS_ABSTRACT) method->func = NULL;
-    else method->func = clLvalue(index2value(L, lua_upvalueindex(3))); //R1
+    else method->func = clLvalue(index2value(L, 3)); //R6
+    //平凡存取方法的标记要和方法体对得上（字节码可能是别处来的），对不上的就当普通方法
+    if (flags & (LUAOBJ_ACCESS_GETTER | LUAOBJ_ACCESS_SETTER) &&
+        (method->func == NULL || !(Objudata_trivial(method->func->p) & flags)))
+        method->flags &= ~(LUAOBJ_ACCESS_GETTER | LUAOBJ_ACCESS_SETTER);
     method->argtypes = NULL;
-    const int nargs = lua_tointeger(L, lua_upvalueindex(5)); //R1
+    method->overload = NULL;
+    method->ocache = NULL;
+    const int nargs = lua_tointeger(L, 5); //R6
     method->nargs = nargs;
     //创建GC表（承担后续对象GC挂载任务）
-    lua_newtable(L); //R2
-    lua_pushvalue(L, -1); //R3
-    lua_setiuservalue(L, -3, OBJLUA_UV_gc + 1); //R2
+    lua_newtable(L); //R7
+    lua_pushvalue(L, -1); //R8
+    lua_setiuservalue(L, -3, OBJLUA_UV_gc + 1); //R7
     //类/方法名/函数都挂载到GC表里
-    lua_pushvalue(L, lua_upvalueindex(1)); //R3 clazz
-    lua_rawseti(L, -2, ++GCIDX); //R2
-    lua_pushvalue(L, lua_upvalueindex(2)); //R3 method name
-    lua_rawseti(L, -2, ++GCIDX); //R2
+    lua_pushvalue(L, 1); //R8 clazz
+    lua_rawseti(L, -2, ++GCIDX); //R7
+    lua_pushvalue(L, 2); //R8 method name
+    lua_rawseti(L, -2, ++GCIDX); //R7
     if (!(flags & LUAOBJ_ACCESS_ABSTRACT)) {
         //抽象方法对应nil这就别捣乱了
-        lua_pushvalue(L, lua_upvalueindex(3)); //R3 method func
-        lua_rawseti(L, -2, ++GCIDX); //R2
+        lua_pushvalue(L, 3); //R8 method func
+        lua_rawseti(L, -2, ++GCIDX); //R7
     }
     if (flags & LUAOBJ_ACCESS_CONSTRUCTOR) {
-        //R2
+        //R7
         //构造函数
         //构造函数自己本身应该绑在clazz的GC表里，并且添加进列表，这一步进行封装使用
-        lua_pushcfunction(L, Objudata_DefConstructor); //R3 需要两个参数:clazz,constructor
-        lua_pushvalue(L,lua_upvalueindex(1)); //R4 clazz
-        lua_pushvalue(L, -4); //R5 constructor
-        lua_call(L, 2, 0); //R2
+        lua_pushcfunction(L, Objudata_DefConstructor); //R8 需要两个参数:clazz,constructor
+        lua_pushvalue(L,1); //R9 clazz
+        lua_pushvalue(L, -4); //R10 constructor
+        lua_call(L, 2, 0); //R7
     } else if (flags & LUAOBJ_ACCESS_META) {
         //元方法
-        lua_pushcfunction(L, Objudata_DefMetaMethod); //R3 需要三个参数:clazz,method,method_name
-        lua_pushvalue(L,lua_upvalueindex(1)); //R4 clazz
-        lua_pushvalue(L, -4); //R5 method
-        lua_pushvalue(L, lua_upvalueindex(2)); //R6 method_name
-        lua_call(L, 3, 0); //R2
+        lua_pushcfunction(L, Objudata_DefMetaMethod); //R8 需要三个参数:clazz,method,method_name
+        lua_pushvalue(L,1); //R9 clazz
+        lua_pushvalue(L, -4); //R10 method
+        lua_pushvalue(L, 2); //R11 method_name
+        lua_call(L, 3, 0); //R7
     } else if (flags & LUAOBJ_ACCESS_ABSTRACT) {
         //抽象方法函数
         //抽象方法和方法基本一样，但是没了函数体
-        lua_pushcfunction(L, Objudata_DefAbstractMethod); //R3 需要两个参数:clazz,method
-        lua_pushvalue(L,lua_upvalueindex(1)); //R4 clazz
-        lua_pushvalue(L, -4); //R5 method
-        lua_call(L, 2, 0); //R2
+        lua_pushcfunction(L, Objudata_DefAbstractMethod); //R8 需要两个参数:clazz,method
+        lua_pushvalue(L,1); //R9 clazz
+        lua_pushvalue(L, -4); //R10 method
+        lua_call(L, 2, 0); //R7
     } else {
         //方法函数
         //方法函数自己本身应该绑在clazz的GC表里，并且添加进列表，这一步进行封装使用
-        lua_pushcfunction(L, Objudata_DefMethod); //R3 需要两个参数:clazz,method
-        lua_pushvalue(L,lua_upvalueindex(1)); //R4 clazz
-        lua_pushvalue(L, -4); //R5 method
-        lua_call(L, 2, 0); //R2
+        lua_pushcfunction(L, Objudata_DefMethod); //R8 需要两个参数:clazz,method
+        lua_pushvalue(L,1); //R9 clazz
+        lua_pushvalue(L, -4); //R10 method
+        lua_call(L, 2, 0); //R7
     }
     GCIDX = luaL_len(L, -1); //GCIDX内部可能已经被添加
     if (nargs > 0) {
-        MethodArgType **argtypes = lua_newuserdatauv(L, nargs * sizeof(MethodArgType *), 0); //R3
+        MethodArgType **argtypes = lua_newuserdatauv(L, nargs * sizeof(MethodArgType *), 0); //R8
         memset(argtypes, 0, nargs * sizeof(MethodArgType *));
         method->argtypes = argtypes;
         //MethodArgType**生命周期交给method
-        lua_rawseti(L, -2, ++GCIDX); //R2
+        lua_rawseti(L, -2, ++GCIDX); //R7
         //初始化
         for (int j = 0; j < nargs; ++j) {
-            MethodArgType *mtype = lua_newuserdatauv(L, sizeof(MethodArgType), MethodArgTypeUpValueMinSize); //R3
+            MethodArgType *mtype = lua_newuserdatauv(L, sizeof(MethodArgType), MethodArgTypeUpValueMinSize); //R8
             memset(mtype, 0, sizeof(MethodArgType));
-            mtype->udata = uvalue(index2value(L, -1)); //R3
+            mtype->udata = uvalue(index2value(L, -1)); //R8
             argtypes[j] = mtype;
             //MethodArgType*生命周期交给method
             lua_rawseti(L, -2, ++GCIDX);
         }
     }
-    lua_settop(L, 1); //R1
+    lua_settop(L, 6); //R6
     return 1; //返回方法
 }
 
+/*
+ * case OP_CKCABSTRACT（抽象方法检查通过之后）
+ * arg1:类
+ * arg2:合成的字段初始化函数（nil为没有带初始值的动态字段）
+ * 类体结束，把自己以及所有父类可见的字段/方法压平成一张表，
+ * 同名的以离自己最近的一层为准（也就是覆盖生效），之后查找就不需要再沿着super一层层找了
+ */
+int RunAtOP_CKCABSTRACT(lua_State *L) {
+    LuaObjUData *clazz = lua_touserdata(L, 1); //R2
+    if (clazz == NULL || !clazz->is_class) luaG_runerror(L, "class finalize failed: target is not a class");
+    lua_getiuservalue(L, 1, OBJLUA_UV_gc + 1); //R3 GC表
+    lua_newtable(L); //R4
+    Table *vtable = hvalue(index2value(L, -1)); //R4
+    for (LuaObjUData *level = clazz; level; level = level->super) {
+        //每一层字段优先于方法，和逐层查找时的顺序一样
+        for (size_t i = 0; i < level->size_fields; ++i) {
+            LuaObjField *field = level->fields[i];
+            if (!isempty(ObjIndex_get(vtable, field->name))) continue;
+            TValue v;
+            setpvalue(&v, field);
+            ObjIndex_set(L, vtable, field->name, &v);
+        }
+        for (size_t i = 0; i < level->size_methods; ++i) {
+            LuaObjMethod *method = level->methods[i];
+            if (!isempty(ObjIndex_get(vtable, method->name))) continue;
+            TValue v;
+            setpvalue(&v, ObjIndex_methods(level->methodindex, method->name));
+            ObjIndex_set(L, vtable, method->name, &v);
+        }
+    }
+    int GCIDX = luaL_len(L, 3); //R4
+    lua_rawseti(L, 3, ++GCIDX); //R3
+    ObjOverload_initcaches(L, clazz->methodindex, clazz->methods, clazz->size_methods);
+    ObjOverload_initcaches(L, clazz->metaindex, clazz->metamethods, clazz->size_metamethods);
+    //构造函数同理：有重载或者唯一的那个有类型限制
+    if (!clazz->ctorcache && (clazz->size_constructors > 1 ||
+                              (clazz->size_constructors == 1 && clazz->constructors[0]->argtypes)))
+        clazz->ctorcache = ObjOverload_newcache(L, clazz->udata);
+    clazz->vtable = vtable;
+    if (lua_isfunction(L, 2)) {
+        clazz->fieldinit = clLvalue(index2value(L, 2)); //R3
+        lua_pushvalue(L, 2); //R4
+        lua_rawseti(L, 3, ++GCIDX); //R3
+    }
+    return 0;
+}
+
+//对象在继承链上属于level这一层类的那部分（类直接就是level本身）
+static LuaObjUData *ObjLevel(LuaObjUData *classOrObj, LuaObjUData *level) {
+    if (classOrObj->is_class) return level;
+    while (classOrObj && classOrObj->classholder != level) classOrObj = classOrObj->super;
+    return classOrObj;
+}
+
+//字段值放在哪：static字段（以及类上的字段）在字段自己身上，对象的非static字段在最外层对象里level这一层的槽里
+static TValue *ObjField_value(LuaObjUData *level, LuaObjField *field) {
+    if (level->is_class || field->flags & LUAOBJ_ACCESS_STATIC) return &field->udata->uv[OBJLUA_UV_fields].uv;
+    return &level->outer->udata->uv[OBJLUA_UV_slots + level->slotbase + field->ivslot].uv;
+}
+
+static lu_byte *ObjField_initconst(LuaObjUData *level, LuaObjField *field) {
+    if (level->is_class || field->flags & LUAOBJ_ACCESS_STATIC) return &field->initconst;
+    return &level->constinit[field->ivslot];
+}
+
+static void ObjField_set(lua_State *L, LuaObjUData *level, LuaObjField *field, const TValue *v) {
+    Udata *owner = level->is_class || field->flags & LUAOBJ_ACCESS_STATIC ? field->udata : level->outer->udata;
+    setobj(L, ObjField_value(level, field), v);
+    luaC_barrierback(L, obj2gco(owner), v);
+}
+
+//classOrObj为NULL时取字段自己身上的值（非static字段就是初始值/初始化函数），classOrObj上没有这个字段返回NULL
+TValue *Objudata_fieldvalue(LuaObjUData *classOrObj, LuaObjField *field, Udata **owner) {
+    LuaObjUData *level = classOrObj ? ObjLevel(classOrObj, field->self) : field->self;
+    if (level == NULL) return NULL;
+    *owner = level->is_class || field->flags & LUAOBJ_ACCESS_STATIC ? field->udata : level->outer->udata;
+    return ObjField_value(level, field);
+}
 
 static int ObjudataMT__tostring(lua_State *L) {
-    LuaObjUData *classOrObj = (LuaObjUData *) lua_touserdata(L, 1);
+    LuaObjUData *classOrObj = Objudata_get(uvalue(index2value(L, 1)));
     lua_pushfstring(L, "%s[%s]: %p", classOrObj->is_class ? "class" : "object",
                     classOrObj->name ? getstr(classOrObj->name) : "<anonymous>",
                     lua_topointer(L, 1));
     return 1;
 }
 
-#define ObjWeakTableGet(L) \
-    TValue *ObjLuaWeakTable = NULL;\
-    if (!luaV_fastget(L, &G(L)->l_registry, luaS_newliteral(L, OBJLUA_WEAK_TABLE), ObjLuaWeakTable, (TValue *) luaH_getshortstr)) {\
-    luaG_runerror(L, "'f_luaopen' not worked: <"OBJLUA_WEAK_TABLE"> is not initialized");\
-    }
-
-#ifndef isvalid
-#define isvalid(L, o)	(!ttisnil(o) || o != &G(L)->nilvalue)
-#endif
 static int
 verify_type(lua_State *L, LuaObjMethod *constructor, MethodArgType **types, MethodArgType *last,
-            int absLowReg,
-            TValue *ObjLuaWeakTable) {
-    TValue *slot;
+            StkId args, int argCount) {
     int checknargs = last->is_vararg ? constructor->nargs - 1 : constructor->nargs;
     int match = 1;
     for (int j = 0; j < checknargs; ++j) {
@@ -423,34 +592,22 @@ verify_type(lua_State *L, LuaObjMethod *constructor, MethodArgType **types, Meth
         if (type->none) continue; //没限制类型
         if (type->is_typemode) {
             //any类型提前转换到none=1了，虽然是typemode格式定义的，但是不归typemode管
-            TValue *o = index2value(L, absLowReg + j);
-            int typeval = isvalid(L, o) ? ttype(o) : LUA_TNONE;
-            char *typestr = ttypename(typeval);
-            char *wish = getstr(type->type);
-            if (strcmp(typestr, wish) != 0) {
+            int typeval = j < argCount ? ttype(s2v(args + j)) : LUA_TNONE;
+            if (!(type->typemask & (1 << (typeval + 1)))) {
                 match = 0;
                 break;
             }
         } else if (type->is_classmode) {
-            //无论是类还是对象，都是注册进弱表的，检查一下就知道数据是否合法
-            TValue *o = index2value(L, absLowReg + j);
-            if (!luaV_fastget(L, ObjLuaWeakTable, o, slot, luaH_get)) {
+            //无论是类还是对象，udata上都有标记，检查一下就知道数据是否合法
+            const TValue *o = j < argCount ? s2v(args + j) : &G(L)->nilvalue;
+            if (!ttisobjlua(o)) {
                 match = 0;
                 break;
             }
-            //这时候检查类型（当然也可能是父类符合，这都算）
-            LuaObjUData *clazz = (LuaObjUData *) getudatamem(uvalue(o));
-            LuaObjUData *wish = type->clazz;
-            int submatch = 0;
-            while (clazz != NULL) {
-                //NULL是顶层了
-                if (wish->classholder == clazz->classholder) {
-                    submatch = 1;
-                    break;
-                }
-                clazz = clazz->super;
-            }
-            if (!submatch) {
+            //这时候检查类型（当然也可能是父类符合，这都算），祖先表里同深度的位置就是它
+            LuaObjUData *clazz = Objudata_get(uvalue(o));
+            LuaObjUData *wish = type->clazz->classholder;
+            if (clazz->depth < wish->depth || clazz->display[wish->depth] != wish) {
                 match = 0;
                 break;
             }
@@ -470,20 +627,20 @@ verify_type(lua_State *L, LuaObjMethod *constructor, MethodArgType **types, Meth
  * include_super 是否包含父类，默认不包含。构造器模式此参数无效果
  * metamethod_mode 是否是元方法模式，是就在method寻找逻辑中使用metamethod的数据找
  * 此函数不检查private
+ * 参数直接在栈上时（比如luaD_precall里还没有C调用帧）用polymorphism_overload_args，args是第一个参数，argCount个
  */
 static LuaObjMethod *
-polymorphism_overload_method(lua_State *L, TString *name, int absLowReg, int absHighReg, LuaObjUData *classOrObj,
-                             lu_byte constructor_mode,
-                             lu_byte include_super, lu_byte metamethod_mode) {
+polymorphism_overload_args(lua_State *L, TString *name, StkId args, int argCount, LuaObjUData *classOrObj,
+                           lu_byte constructor_mode,
+                           lu_byte include_super, lu_byte metamethod_mode);
+
+static LuaObjMethod *
+polymorphism_overload_resolve(lua_State *L, TString *name, StkId args, int argCount, LuaObjUData *classOrObj,
+                              lu_byte constructor_mode,
+                              lu_byte include_super, lu_byte metamethod_mode) {
     if (!constructor_mode && !name)
         luaG_runerror(L, "polymorphism method need name.");
     LuaObjMethod *method = NULL;
-    if (absLowReg < 0 || absHighReg < 0) return method;
-    ObjWeakTableGet(L);
-    int argCount = 0;
-    if (absLowReg <= absHighReg) {
-        argCount = absHighReg - absLowReg + 1;
-    }
     if (constructor_mode) {
         //第一遍遍历，先把有定义类型的构造函数分出来
         for (size_t i = 0; i < classOrObj->size_constructors; ++i) {
@@ -493,7 +650,7 @@ polymorphism_overload_method(lua_State *L, TString *name, int absLowReg, int abs
             //检查最后一个是不是is_vararg，不是就直接比较长度（无参数的不是多态，也就是说nargs>=1）
             MethodArgType *last = types[constructor->nargs - 1];
             if (!last->is_vararg && constructor->nargs != argCount) continue; //快速跳过不定长方法长度不匹配的
-            if (verify_type(L, constructor, types, last, absLowReg, ObjLuaWeakTable))
+            if (verify_type(L, constructor, types, last, args, argCount))
                 return constructor; //第一优先原则，找到就不找更符合的了
         }
         //第二遍遍历，把第一个没有类型要求的构造函数找出来
@@ -503,252 +660,628 @@ polymorphism_overload_method(lua_State *L, TString *name, int absLowReg, int abs
         }
         return NULL; //返回NULL，不报错
     } else {
+        //同名方法已经由索引串成重载链了
+        LuaObjMethod *overloads = ObjIndex_methods(metamethod_mode ? classOrObj->metaindex : classOrObj->methodindex,
+                                                   name);
         //第一遍遍历，先把有定义类型的函数分出来
-        size_t size_methods = classOrObj->size_methods;
-        LuaObjMethod **methods = classOrObj->methods;
-        if (metamethod_mode) {
-            size_methods = classOrObj->size_metamethods;
-            methods = classOrObj->metamethods;
-        }
-        for (size_t i = 0; i < size_methods; ++i) {
-            //匹配方法名
-            method = methods[i];
-            if (luaS_streq(name, method->name)) {
-                MethodArgType **types = method->argtypes;
-                if (!types) continue;
-                //检查最后一个是不是is_vararg，不是就直接比较长度（无参数的不是多态，也就是说nargs>=1）
-                MethodArgType *last = types[method->nargs - 1];
-                MethodArgType *fst = types[0];
-                if (!last->is_vararg && method->nargs != argCount) continue; //快速跳过不定长方法长度不匹配的
-                if (verify_type(L, method, types, last, absLowReg, ObjLuaWeakTable)) return method; //第一优先原则，找到就不找更符合的了
-            }
+        for (method = overloads; method; method = method->overload) {
+            MethodArgType **types = method->argtypes;
+            if (!types) continue;
+            //检查最后一个是不是is_vararg，不是就直接比较长度（无参数的不是多态，也就是说nargs>=1）
+            MethodArgType *last = types[method->nargs - 1];
+            if (!last->is_vararg && method->nargs != argCount) continue; //快速跳过不定长方法长度不匹配的
+            if (verify_type(L, method, types, last, args, argCount)) return method; //第一优先原则，找到就不找更符合的了
         }
         //第二遍遍历，把第一个没有类型要求的构造函数找出来
-        for (size_t i = 0; i < size_methods; ++i) {
-            //匹配方法名
-            method = methods[i];
-            if (luaS_streq(name, method->name)) {
-                if (!method->argtypes) return method; //找到了，直接返回
-            }
+        for (method = overloads; method; method = method->overload) {
+            if (!method->argtypes) return method; //找到了，直接返回
         }
         if (include_super && classOrObj->super) {
-            method = polymorphism_overload_method(L, name, absLowReg, absHighReg, classOrObj->super, constructor_mode,
-                                                  include_super, metamethod_mode);
+            method = polymorphism_overload_args(L, name, args, argCount, classOrObj->super, constructor_mode,
+                                                include_super, metamethod_mode);
             if (method) return method;
         }
         return NULL; //返回NULL，不报错
     }
 }
 
+//实参签名：每个参数的类型，ObjLua类/对象再带上类编号，verify_type的结果完全由它决定
+static void ObjOverload_signature(StkId args, int argCount, size_t *sig) {
+    for (int j = 0; j < argCount; ++j) {
+        const TValue *o = s2v(args + j);
+        size_t s = ttype(o);
+        if (ttisobjlua(o))
+            s |= Objudata_get(uvalue(o))->classid << 4;
+        sig[j] = s;
+    }
+}
+
+static LuaObjMethod *
+polymorphism_overload_args(lua_State *L, TString *name, StkId args, int argCount, LuaObjUData *classOrObj,
+                           lu_byte constructor_mode,
+                           lu_byte include_super, lu_byte metamethod_mode) {
+    OverloadCache *cache = NULL;
+    //类定义完了才用缓存（定义期间重载还会继续增加）
+    if (classOrObj->vtable && argCount <= OBJLUA_OVERLOAD_MAXARGS) {
+        if (constructor_mode) {
+            cache = classOrObj->classholder->ctorcache;
+        } else if (name && include_super) {
+            LuaObjMethod *head = ObjIndex_methods(metamethod_mode ? classOrObj->metaindex : classOrObj->methodindex,
+                                                  name);
+            //只有一个没有类型限制的定义，不管什么参数都是它
+            if (head && !head->overload && !head->argtypes) return head;
+            if (head) cache = head->ocache;
+        }
+    }
+    if (!cache)
+        return polymorphism_overload_resolve(L, name, args, argCount, classOrObj, constructor_mode, include_super,
+                                             metamethod_mode);
+    size_t sig[OBJLUA_OVERLOAD_MAXARGS];
+    ObjOverload_signature(args, argCount, sig);
+    for (int i = 0; i < OBJLUA_OVERLOAD_CACHESIZE; ++i) {
+        OverloadCacheEntry *e = &cache->entries[i];
+        if (e->argc == argCount && memcmp(e->sig, sig, sizeof(size_t) * argCount) == 0)
+            return e->method;
+    }
+    LuaObjMethod *method = polymorphism_overload_resolve(L, name, args, argCount, classOrObj, constructor_mode,
+                                                         include_super, metamethod_mode);
+    if (method) {
+        //没找到的会报错，不缓存
+        OverloadCacheEntry *e = &cache->entries[cache->next];
+        cache->next = (cache->next + 1) % OBJLUA_OVERLOAD_CACHESIZE;
+        e->argc = argCount;
+        memcpy(e->sig, sig, sizeof(size_t) * argCount);
+        e->method = method;
+    }
+    return method;
+}
+
+static LuaObjMethod *
+polymorphism_overload_method(lua_State *L, TString *name, int absLowReg, int absHighReg, LuaObjUData *classOrObj,
+                             lu_byte constructor_mode,
+                             lu_byte include_super, lu_byte metamethod_mode) {
+    if (absLowReg < 0 || absHighReg < 0) return NULL;
+    int argCount = 0;
+    if (absLowReg <= absHighReg) {
+        argCount = absHighReg - absLowReg + 1;
+    }
+    return polymorphism_overload_args(L, name, L->ci->func.p + absLowReg, argCount, classOrObj, constructor_mode,
+                                      include_super, metamethod_mode);
+}
+
 
 /*
- * 抽象__call，如果索引到方法，通过这个函数完成代理，提供抽象函数
- * 因为多态只有调用才知道是哪个方法
- * 第一个上值存储对象或者类自己
- * 第二个上值存储方法名字，nil时为构建器
- * 第三个是根据__index期间确定提供方法的对象或者类（自己或者父类都有可能）
+ * Lua函数层ci是在替谁工作：luaD_precall直接压栈的方法调用帧带CIST_OBJMETHOD，self在u.l.objself，
+ * 否则看上一层是不是方法包装层（C里lua_call方法的路径），都不是返回NULL
  */
-static int ObjudataMT__abstractcall(lua_State *L) {
-    LuaObjUData *classOrObj = (LuaObjUData *) lua_touserdata(L, lua_upvalueindex(1));
-    LuaObjUData *methodClassOrObj = (LuaObjUData *) lua_touserdata(L, lua_upvalueindex(3));
-    int nargs = lua_gettop(L);
-    int have_access = 0;
-    CallInfo *lastCall = L->ci;
-    if (lastCall && lastCall->previous) lastCall = lastCall->previous; //来到Lua函数层
-    if (lastCall && lastCall->previous) lastCall = lastCall->previous; //来到MethodWrapCall层
+LuaObjUData *Objudata_ciself(CallInfo *ci) {
+    if (ci == NULL || !(ci->callstatus & CIST_OBJMETHOD)) return NULL;
+    return Objudata_get(ci->u.l.objself);
+}
+
+/*
+ * 方法帧开始时（OP_METHODINIT/objlua.getMethodInit）定下它替谁工作，之后整个帧的类内访问只看CIST_OBJMETHOD标记
+ * luaD_precall直接压的方法帧已经带标记，经过方法包装层调用的这里往上看一层：
+ * Objudata_metaProxy的self在它的栈底，其它包装层的self是上值1
+ */
+LuaObjUData *Objudata_methodinit(CallInfo *ci) {
+    if (ci->callstatus & CIST_OBJMETHOD) return Objudata_get(ci->u.l.objself);
+    CallInfo *lastCall = ci->previous; //来到MethodWrapCall层
+    Udata *self = NULL;
     if (lastCall && ttypetag(s2v(lastCall->func.p)) == LUA_VCCL) {
         CClosure *wrapcall = clCvalue(s2v(lastCall->func.p));
-        if ((Objudata_MethodWrapCall == wrapcall->f ||
-             Objudata_metaProxy == wrapcall->f)
-            && wrapcall->nupvalues >= 2) {
-            //检查是不是类内调用
-            LuaObjUData *classobj = (LuaObjUData *) getudatamem(uvalue(&wrapcall->upvalue[0]));
-            if (classobj == classOrObj || classobj->classholder == classOrObj->classholder)
-                have_access = 1;
-        }
+        if (wrapcall->f == Objudata_metaProxy)
+            self = uvalue(s2v(lastCall->func.p + 1));
+        else if (Objudata_isMethodWrap(wrapcall))
+            self = uvalue(&wrapcall->upvalue[0]);
     }
-    if (lua_isnil(L, lua_upvalueindex(2))) {
-        //构建器
+    if (self == NULL) return NULL;
+    ci->callstatus |= CIST_OBJMETHOD;
+    ci->u.l.objself = self;
+    return Objudata_get(self);
+}
+
+static int ObjudataMT__access(lua_State *L, LuaObjUData *origin) {
+    return Objudata_access(L->ci->previous, origin); //L->ci是元方法自己，上一层是Lua函数层
+}
+
+/*
+ * 代理函数proxy（ObjudataMT__abstractcall）被调用时决定调用哪个方法，多态只有这时候才知道
+ * args开始的nargs个是参数，have_access是调用方是不是类内
+ */
+static LuaObjMethod *ObjProxy_resolve(lua_State *L, CClosure *proxy, StkId args, int nargs, int have_access) {
+    LuaObjUData *classOrObj = Objudata_get(uvalue(&proxy->upvalue[0]));
+    LuaObjUData *methodClassOrObj = Objudata_get(uvalue(&proxy->upvalue[2]));
+    LuaObjMethod *method;
+    if (ttisnil(&proxy->upvalue[1])) {
+        //构建器，private的在前置检查里就要求类内了
         if (classOrObj->is_class || !have_access) luaG_runerror(L, "constructor pre check failed.");
-        LuaObjMethod *constructor = polymorphism_overload_method(L, NULL, 1, nargs, methodClassOrObj, 1, 0, 0);
-        if (!constructor) luaG_runerror(L, "constructor not found");
-        LuaObjAccessFlags flags = constructor->flags;
-        if (flags & LUAOBJ_ACCESS_PUBLIC) {
-        constructor_call:;
-            lua_pushvalue(L, lua_upvalueindex(1));
-            lua_pushnil(L);
-            TValue *o = index2value(L, -1);
-            setuvalue(L, o, constructor->udata);
-            lua_pushcclosure(L, Objudata_MethodWrapCall, 2);
-            for (int i = 1; i <= nargs; ++i) {
-                lua_pushvalue(L, i);
-            }
-            lua_call(L, nargs, LUA_MULTRET);
-            return lua_gettop(L) - nargs;
-        } else if (flags & LUAOBJ_ACCESS_PRIVATE) {
-            //检查过了
-            // if (!have_access) luaG_runerror(L, "private constructor cannot be accessed");
-            goto constructor_call;
-        } else luaG_runerror(L, "method not have public or private access");
+        method = polymorphism_overload_args(L, NULL, args, nargs, methodClassOrObj, 1, 0, 0);
+        if (!method) luaG_runerror(L, "constructor not found");
     } else {
-        TValue *methodNameO = index2value(L, lua_upvalueindex(2));
-        TString *methodName = tsvalue(methodNameO);
-        //之前就已经确定了的最搞出现这个函数的类，不用从最叶子开始找，当然多态问题可能不是当前层可能还在super，所以还得包括super
-        LuaObjMethod *method = polymorphism_overload_method(L, methodName, 1, nargs, methodClassOrObj, 0, 1, 0);
-        // 不信赖methodClassOrObj那就从classOrObj从头找，除非中途增加新方法，但是这对吗？这不对吧，增加方法说明还是定义阶段，定义阶段哪里来的CallMethod
-        // LuaObjMethod *method = polymorphism_overload_method(L, methodName, 1, nargs, classOrObj, 0, 1, 0);
-        if (!method) {
-            method = polymorphism_overload_method(L, methodName, 1, nargs, methodClassOrObj, 0, 1, 0);
-            luaG_runerror(L, "method '%s' not found",getstr(methodName));
+        TString *methodName = tsvalue(&proxy->upvalue[1]);
+        if (proxy->nupvalues > 3) {
+            //@final绑定时就定死了是哪个方法，不用再找
+            method = (LuaObjMethod *) pvalue(&proxy->upvalue[3]);
+        } else {
+            //之前就已经确定了的最搞出现这个函数的类，不用从最叶子开始找，当然多态问题可能不是当前层可能还在super，所以还得包括super
+            method = polymorphism_overload_args(L, methodName, args, nargs, methodClassOrObj, 0, 1, 0);
+            if (!method) luaG_runerror(L, "method '%s' not found", getstr(methodName));
         }
-        LuaObjAccessFlags flags = method->flags;
-        if (flags & LUAOBJ_ACCESS_PUBLIC) {
-        do_call:;
-            lua_pushvalue(L, lua_upvalueindex(1));
-            lua_pushnil(L);
-            TValue *o = index2value(L, -1);
-            setuvalue(L, o, method->udata);
-            lua_pushcclosure(L, Objudata_MethodWrapCall, 2);
-            for (int i = 1; i <= nargs; ++i) {
-                lua_pushvalue(L, i);
-            }
-            lua_call(L, nargs, LUA_MULTRET);
-            return lua_gettop(L) - nargs;
-        } else if (flags & LUAOBJ_ACCESS_PRIVATE) {
-            if (!have_access) luaG_runerror(L, "private method '%s' cannot be accessed", getstr(methodName));
-            goto do_call;
-        } else luaG_runerror(L, "method not have public or private access");
+        if (method->flags & LUAOBJ_ACCESS_PRIVATE && !have_access)
+            luaG_runerror(L, "private method '%s' cannot be accessed", getstr(methodName));
     }
+    if (!(method->flags & (LUAOBJ_ACCESS_PUBLIC | LUAOBJ_ACCESS_PRIVATE)))
+        luaG_runerror(L, "method not have public or private access");
+    return method;
 }
 
-static int ObjudataMT__indexImpl(lua_State *L, LuaObjUData *origin, LuaObjUData *classOrObj, TString *key) {
-    int have_access = 0;
-    CallInfo *lastCall = L->ci;
-    if (lastCall && lastCall->previous) lastCall = lastCall->previous; //来到Lua函数层
-    if (lastCall && lastCall->previous) lastCall = lastCall->previous; //来到MethodWrapCall层
-    if (lastCall && ttypetag(s2v(lastCall->func.p)) == LUA_VCCL) {
-        CClosure *wrapcall = clCvalue(s2v(lastCall->func.p));
-        if ((Objudata_MethodWrapCall == wrapcall->f ||
-             Objudata_metaProxy == wrapcall->f)
-            && wrapcall->nupvalues >= 2) {
-            //检查是不是类内调用
-            LuaObjUData *classobj = (LuaObjUData *) getudatamem(uvalue(&wrapcall->upvalue[0]));
-            if (classobj == origin || classobj->classholder == origin->classholder)
-                have_access = 1;
+static StkId ObjMeta_bind(lua_State *L, StkId func);
+
+/*
+ * 平凡的存取方法：方法体只有 -> self.字段 / { return self.字段 } 或者 { self.字段 = 参数 }，
+ * 而且字段是按槽位访问的（OP_GETSLOT/OP_SETSLOT），返回LUAOBJ_ACCESS_GETTER/LUAOBJ_ACCESS_SETTER，不是返回0
+ */
+LuaObjAccessFlags Objudata_trivial(const Proto *p) {
+    const Instruction *code = p->code;
+    if (p->is_vararg || p->sizecode < 4) return 0;
+    if (GET_OPCODE(code[0]) != OP_METHODINIT || GETARG_A(code[0]) != 0) return 0;
+    if (GET_OPCODE(code[2]) != OP_EXTRAARG) return 0;
+    Instruction i = code[1];
+    if (p->numparams == 2 && p->sizecode == 5 && GET_OPCODE(i) == OP_GETSLOT && GETARG_B(i) == 0 &&
+        GET_OPCODE(code[3]) == OP_RETURN1 && GETARG_A(code[3]) == GETARG_A(i))
+        return LUAOBJ_ACCESS_GETTER;
+    if (p->numparams == 3 && p->sizecode == 4 && GET_OPCODE(i) == OP_SETSLOT && GETARG_A(i) == 0 &&
+        !GETARG_k(i) && GETARG_C(i) == 2 && GET_OPCODE(code[3]) == OP_RETURN0)
+        return LUAOBJ_ACCESS_SETTER;
+    return 0;
+}
+
+/*
+ * 平凡存取方法（Objudata_trivial）不压Lua帧，直接读写self的字段，结果从func开始放，返回结果个数
+ * 槽位用方法体里那条OP_GETSLOT/OP_SETSLOT自己的内联缓存，没命中（第一次、换了接收者的类）或者有钩子要看到调用的
+ * 返回-1照常调用，由那条指令去填缓存；方法体就是替self工作，private字段不用再查类内访问
+ */
+static int ObjTrivial_call(lua_State *L, StkId func, LuaObjUData *self, const LuaObjMethod *method) {
+    LuaObjAccessFlags kind = method->flags & (LUAOBJ_ACCESS_GETTER | LUAOBJ_ACCESS_SETTER);
+    if (!kind || L->hookmask) return -1;
+    const Proto *p = method->func->p;
+    if (p->objic == NULL) return -1;
+    const ObjInlineCache *ic = &p->objic[1]; //OP_GETSLOT/OP_SETSLOT
+    if (ic->kind != OBJIC_SLOT || ic->classid != self->classid || self->is_class ||
+        self->udata->metatable != ic->mt)
+        return -1;
+    LuaObjUData *level = self + ic->levelofs;
+    Udata *u = level->outer->udata;
+    TValue *v = &u->uv[OBJLUA_UV_slots + level->slotbase + GETARG_Ax(p->code[2])].uv;
+    if (kind == LUAOBJ_ACCESS_SETTER) {
+        if (L->top.p > func + 1) {
+            setobj(L, v, s2v(func + 1));
+            luaC_barrierback(L, obj2gco(u), v);
+        } else
+            setnilvalue(v);
+        L->top.p = func;
+        return 0;
+    }
+    setobj2s(L, func, v);
+    L->top.p = func + 1;
+    return 1;
+}
+
+//origin的各祖先类被objlua.clearMemo过几次，和建立缓存时记下的对不上就作废
+static unsigned int ObjMemo_gen(const LuaObjUData *origin) {
+    unsigned int gen = 0;
+    for (int d = 0; d <= origin->depth; ++d) gen += origin->display[d]->memoepoch;
+    return gen;
+}
+
+//origin现在有效的@memo缓存，没有返回NULL
+static Table *ObjMemo_table(const LuaObjUData *origin) {
+    TValue k;
+    setpvalue(&k, (void *) origin);
+    const TValue *v = luaH_get(hvalue(&origin->outer->udata->uv[OBJLUA_UV_gc].uv), &k);
+    return ttistable(v) && origin->memogen == ObjMemo_gen(origin) ? hvalue(v) : NULL;
+}
+
+//参数里有nil/NaN/-0.0的当不了键（-0.0和0.0作为键是同一个），这次不缓存
+static int ObjMemo_keyable(StkId args, int nargs) {
+    for (int i = 0; i < nargs; ++i) {
+        const TValue *o = s2v(args + i);
+        if (ttisnil(o)) return 0;
+        if (ttisfloat(o)) {
+            lua_Number n = fltvalue(o);
+            if (luai_numisnan(n) || (n == 0 && 1 / n < 0)) return 0;
         }
     }
-    LuaObjAccessFlags flags;
-    //遍历fields
-    for (size_t i = 0; i < classOrObj->size_fields; ++i) {
-        LuaObjField *field = classOrObj->fields[i];
-        if (luaS_streq(field->name, key)) {
-            flags = field->flags;
-            if (flags & LUAOBJ_ACCESS_PUBLIC) {
-            index_field:;
-                if (!(flags & LUAOBJ_ACCESS_STATIC) && origin->is_class)
-                    luaG_runerror(L, "object field '%s' cannot be accessed as static", getstr(key));
-                lua_pushnil(L);
-                setobj2n(L, index2value(L, -1), &field->udata->uv[OBJLUA_UV_fields].uv);
-                return 1;
-            } else if (flags & LUAOBJ_ACCESS_PRIVATE) {
-                if (!have_access) luaG_runerror(L, "private field '%s' cannot be accessed", getstr(key));
-                goto index_field;
-            } else luaG_runerror(L, "field not have public or private access");
+    return 1;
+}
+
+/*
+ * 浮点参数不直接挂在节点上：表键会把1.0规范成1，和整数参数撞在一起，
+ * 所以先经过节点[ObjMemo_floattag]这个只放浮点的分支，再用值做键
+ */
+static const char ObjMemo_floattag = 0;
+
+/*
+ * 查origin上method这组参数缓存过的结果（结果表：[0]是个数，1..n是结果），没有返回NULL
+ * 只读不分配，luaD_precall/luaD_pretailcall里也能用
+ */
+static Table *ObjMemo_get(lua_State *L, const LuaObjUData *origin, const LuaObjMethod *method, StkId args,
+                          int nargs) {
+    Table *memo = ObjMemo_table(origin);
+    if (memo == NULL || !ObjMemo_keyable(args, nargs)) return NULL;
+    TValue k;
+    setpvalue(&k, (void *) method);
+    const TValue *v = luaH_get(memo, &k);
+    for (int i = 0; ttistable(v) && i < nargs; ++i) {
+        const TValue *arg = s2v(args + i);
+        if (ttisfloat(arg)) {
+            setpvalue(&k, (void *) &ObjMemo_floattag);
+            v = luaH_get(hvalue(v), &k);
+            if (!ttistable(v)) break;
         }
+        v = luaH_get(hvalue(v), arg);
     }
-    //遍历methods
-    LuaObjMethod *method;
-    for (size_t i = 0; i < classOrObj->size_methods; ++i) {
-        method = classOrObj->methods[i];
-        flags = method->flags;
+    if (!ttistable(v)) return NULL;
+    Table *node = hvalue(v);
+    sethvalue(L, &k, node);
+    v = luaH_get(node, &k);
+    return ttistable(v) ? hvalue(v) : NULL;
+}
+
+//origin的缓存压栈，没有、作废了或者满了就新建一个顶掉旧的
+static void ObjMemo_root(lua_State *L, LuaObjUData *origin) {
+    Table *memo = ObjMemo_table(origin);
+    if (memo && origin->nmemo < OBJLUA_MEMO_MAX) {
+        lua_pushnil(L); //R1
+        sethvalue2s(L, L->top.p - 1, memo); //R1
+        return;
+    }
+    lua_newtable(L); //R1
+    lua_pushnil(L); //R2
+    setuvalue(L, index2value(L, -1), origin->outer->udata); //R2
+    lua_getiuservalue(L, -1, OBJLUA_UV_gc + 1); //R3
+    lua_pushvalue(L, -3); //R4
+    lua_rawsetp(L, -2, origin); //R3
+    lua_pop(L, 2); //R1
+    origin->nmemo = 0;
+    origin->memogen = ObjMemo_gen(origin);
+}
+
+//栈顶是节点和键，换成节点[键]这个子节点，没有就建一个
+static void ObjMemo_child(lua_State *L) {
+    //R2：节点 键
+    lua_pushvalue(L, -1); //R3
+    if (lua_rawget(L, -3) != LUA_TTABLE) { //R3
+        lua_pop(L, 1); //R2
+        lua_newtable(L); //R3
+        lua_pushvalue(L, -2); //R4
+        lua_pushvalue(L, -2); //R5
+        lua_rawset(L, -5); //R3
+    }
+    lua_replace(L, -3); //R2
+    lua_pop(L, 1); //R1
+}
+
+/*
+ * 没命中时把method这组参数对应的前缀树节点建好压栈，返回1，方法执行完由ObjMemo_finish把结果挂上去；
+ * 参数当不了键的什么也不压，返回0（路径和ObjMemo_get一致）
+ */
+static int ObjMemo_node(lua_State *L, LuaObjUData *origin, const LuaObjMethod *method, int argbase, int nargs) {
+    if (!ObjMemo_keyable(L->ci->func.p + argbase, nargs)) return 0;
+    ObjMemo_root(L, origin); //R1
+    lua_pushlightuserdata(L, (void *) method); //R2
+    ObjMemo_child(L); //R1
+    for (int i = 0; i < nargs; ++i) {
+        if (lua_type(L, argbase + i) == LUA_TNUMBER && !lua_isinteger(L, argbase + i)) {
+            lua_pushlightuserdata(L, (void *) &ObjMemo_floattag); //R2
+            ObjMemo_child(L); //R1
+        }
+        lua_pushvalue(L, argbase + i); //R2
+        ObjMemo_child(L); //R1
+    }
+    return 1;
+}
+
+//扔掉classOrObj的@memo缓存：类的连同它和子类的对象一起作废，对象的是它所有层的
+void Objudata_clearmemo(lua_State *L, LuaObjUData *classOrObj) {
+    if (classOrObj->is_class) {
+        classOrObj->memoepoch++;
+        return;
+    }
+    LuaObjUData *outer = classOrObj->outer;
+    lua_pushnil(L); //R1
+    setuvalue(L, index2value(L, -1), outer->udata); //R1
+    lua_getiuservalue(L, -1, OBJLUA_UV_gc + 1); //R2
+    for (LuaObjUData *level = outer; level <= outer + outer->depth; ++level) {
+        lua_pushnil(L); //R3
+        lua_rawsetp(L, -2, level); //R2
+    }
+    lua_pop(L, 2); //R0
+}
+
+/*
+ * 调用代理函数时原地换成它选中的方法：proxy arg1 arg2 ... 变成 func self super arg1 arg2 ...，
+ * 类内访问按L->ci（调用方）算，栈可能重新分配，返回换好之后的func（元方法代理见ObjMeta_bind）
+ * 选中的是平凡存取方法或者@memo方法命中缓存时直接在这里做完，结果按nresults调整好放在func开始，返回NULL；
+ * @memo方法没命中（或者开着钩子）时原样返回func（还是代理函数），交给代理函数自己的C函数体调用并记下结果，
+ * 这样钩子照样能看到一次真正的调用和返回
+ */
+StkId Objudata_bind(lua_State *L, StkId func, int nresults) {
+    CClosure *proxy = clCvalue(s2v(func));
+    if (proxy->f == Objudata_metaProxy) return ObjMeta_bind(L, func);
+    LuaObjUData *self = Objudata_get(uvalue(&proxy->upvalue[0]));
+    int nargs = cast_int(L->top.p - func) - 1;
+    LuaObjMethod *method = ObjProxy_resolve(L, proxy, func + 1, nargs, Objudata_access(L->ci, self));
+    int n = nresults >= LUA_MULTRET ? ObjTrivial_call(L, func, self, method) : -1;
+    if (n < 0 && method->flags & LUAOBJ_ACCESS_MEMO) {
+        Table *res;
+        //没命中（还有要关闭变量的C调用方、开着钩子要看到这次调用的）交给代理函数的C函数体
+        if (nresults < LUA_MULTRET || L->hookmask || (res = ObjMemo_get(L, self, method, func + 1, nargs)) == NULL)
+            return func;
+        n = cast_int(ivalue(luaH_getint(res, 0)));
+        checkstackGCp(L, n, func); //结果表挂在缓存上，proxy还在func上，GC不会收走
+        for (int i = 0; i < n; ++i)
+            setobj2s(L, func + i, luaH_getint(res, i + 1));
+        L->top.p = func + n;
+    }
+    if (n >= 0) {
+        if (nresults != LUA_MULTRET) {
+            for (; n < nresults; n++) setnilvalue(s2v(func + n));
+            L->top.p = func + nresults;
+        }
+        return NULL;
+    }
+    checkstackGCp(L, 2, func); //proxy还在func上，GC不会收走self
+    for (StkId p = L->top.p - 1; p > func; p--)
+        setobjs2s(L, p + 2, p);
+    L->top.p += 2;
+    setclLvalue2s(L, func, method->func);
+    setuvalue(L, s2v(func + 1), self->udata);
+    if (self->super) {
+        setuvalue(L, s2v(func + 2), Objudata_udata(L, self->super));
+    } else
+        setnilvalue(s2v(func + 2));
+    return func;
+}
+
+/*
+ * luaD_precall遇到代理函数时由Objudata_bind换好之后直接把方法的Lua调用帧压栈，不经过任何C调用帧，
+ * 新帧带CIST_OBJMETHOD并记住self，OP_METHODINIT和类内访问检查都从这里拿（尾调用见luaD_pretailcall）
+ */
+CallInfo *Objudata_precall(lua_State *L, StkId func, int nresults) {
+    Udata *self = uvalue(s2v(func + 1));
+    CallInfo *ci = luaD_precall(L, func, nresults);
+    ci->callstatus |= CIST_OBJMETHOD;
+    ci->u.l.objself = self;
+    return ci;
+}
+
+//方法包装层的lua_callk结束（或者方法让出后恢复）：栈上ctx个之后的都是方法的返回值
+static int ObjWrap_finish(lua_State *L, int status, lua_KContext ctx) {
+    (void) status;
+    return lua_gettop(L) - (int) ctx;
+}
+
+//@memo方法没命中时的lua_callk结束：栈底是ObjMemo_node建好的节点，之后都是方法的返回值，记下来再原样返回
+static int ObjMemo_finish(lua_State *L, int status, lua_KContext ctx) {
+    (void) status;
+    LuaObjUData *origin = Objudata_get(uvalue(index2value(L, lua_upvalueindex(1))));
+    int nres = lua_gettop(L) - (int) ctx;
+    lua_createtable(L, nres, 1);
+    for (int i = 1; i <= nres; ++i) {
+        lua_pushvalue(L, (int) ctx + i);
+        lua_rawseti(L, -2, i);
+    }
+    lua_pushinteger(L, nres);
+    lua_rawseti(L, -2, 0);
+    lua_pushvalue(L, 1);
+    lua_insert(L, -2);
+    lua_rawset(L, 1); //节点[节点] = 结果
+    origin->nmemo++;
+    return ObjWrap_finish(L, status, ctx);
+}
+
+/*
+ * 抽象__call，如果索引到方法，通过这个函数完成代理，提供抽象函数
+ * 因为多态只有调用才知道是哪个方法
+ * 第一个上值存储对象或者类自己
+ * 第二个上值存储方法名字，nil时为构建器
+ * 第三个是根据__index期间确定提供方法的对象或者类（自己或者父类都有可能）
+ * 第四个（可选）是直接绑定的方法，@final方法或者@final类上只有一个不限类型的定义时才有，调用时不再查找
+ * 由__index缓存在boundcache里复用；平时由luaD_precall直接压方法帧（Objudata_precall），
+ * 只有从C里调用（lua_call之类）时才真正进这个C函数，这时它自己充当方法包装层（见Objudata_isMethodWrap）
+ */
+int ObjudataMT__abstractcall(lua_State *L) {
+    int nargs = lua_gettop(L);
+    LuaObjUData *classOrObj = Objudata_get(uvalue(index2value(L, lua_upvalueindex(1))));
+    CClosure *proxy = clCvalue(s2v(L->ci->func.p));
+    LuaObjMethod *method = ObjProxy_resolve(L, proxy, L->ci->func.p + 1, nargs, ObjudataMT__access(L, classOrObj));
+    int memo = 0;
+    if (method->flags & LUAOBJ_ACCESS_MEMO) {
+        Table *res = ObjMemo_get(L, classOrObj, method, L->ci->func.p + 1, nargs);
+        if (res) {
+            int n = cast_int(ivalue(luaH_getint(res, 0)));
+            luaL_checkstack(L, n + 1, NULL);
+            lua_pushnil(L);
+            sethvalue2s(L, L->top.p - 1, res);
+            int t = lua_gettop(L);
+            for (int i = 1; i <= n; ++i) lua_rawgeti(L, t, i);
+            return n;
+        }
+        memo = ObjMemo_node(L, classOrObj, method, 1, nargs);
+        if (memo) lua_insert(L, 1); //节点放栈底，ObjMemo_finish用
+    }
+    //self/super需要预留好空间，因为寄存器初始分配因为包装接管了
+    lua_pushnil(L), lua_insert(L, memo + 1);
+    lua_pushnil(L), lua_insert(L, memo + 1);
+    lua_pushnil(L);
+    setclLvalue(L, index2value(L, -1), method->func);
+    lua_insert(L, memo + 1);
+    // [节点] func [self] [super] arg1 arg2 ...
+    lua_callk(L, nargs + 2, LUA_MULTRET, memo, memo ? ObjMemo_finish : ObjWrap_finish);
+    return memo ? ObjMemo_finish(L, LUA_OK, memo) : ObjWrap_finish(L, LUA_OK, 0);
+}
+
+static int ObjudataMT__indexField(lua_State *L, LuaObjUData *origin, LuaObjUData *level, LuaObjField *field,
+                                  TString *key, int have_access) {
+    LuaObjAccessFlags flags = field->flags;
+    if (flags & LUAOBJ_ACCESS_PUBLIC) {
+    index_field:;
+        if (!(flags & LUAOBJ_ACCESS_STATIC) && origin->is_class)
+            luaG_runerror(L, "object field '%s' cannot be accessed as static", getstr(key));
+        lua_pushnil(L);
+        setobj2n(L, index2value(L, -1), ObjField_value(level, field));
+        return 1;
+    } else if (flags & LUAOBJ_ACCESS_PRIVATE) {
+        if (!have_access) luaG_runerror(L, "private field '%s' cannot be accessed", getstr(key));
+        goto index_field;
+    } else luaG_runerror(L, "field not have public or private access");
+    return 0;
+}
+
+//懒创建origin的绑定方法缓存，挂在origin（父层就是最外层对象）的GC表里
+static Table *ObjBound_newcache(lua_State *L, LuaObjUData *origin, int have_access) {
+    lua_newtable(L); //R1
+    Table *cache = hvalue(index2value(L, -1)); //R1
+    lua_pushnil(L); //R2
+    setuvalue(L, index2value(L, -1), origin->outer->udata); //R2
+    lua_getiuservalue(L, -1, OBJLUA_UV_gc + 1); //R3
+    int GCIDX = luaL_len(L, -1); //R3
+    lua_pushvalue(L, -3); //R4
+    lua_rawseti(L, -2, ++GCIDX); //R3
+    lua_pop(L, 3); //R0
+    origin->boundcache[have_access] = cache;
+    return cache;
+}
+
+//在level这一层的同名重载链里找一个能访问的，找到就压入代理函数，否则返回0
+static int ObjudataMT__indexMethod(lua_State *L, LuaObjUData *origin, LuaObjUData *level, LuaObjMethod *method,
+                                   TString *key, int have_access) {
+    for (; method; method = method->overload) {
+        LuaObjAccessFlags flags = method->flags;
         if (flags & LUAOBJ_ACCESS_PRIVATE && !have_access) continue;
         if (!(flags & LUAOBJ_ACCESS_STATIC) && origin->is_class) continue;
-        if (luaS_streq(method->name, key)) {
-            //肯定不能直接返回这个方法，因为多态，返回一个代理函数，干__call的活，abstractcall传origin
-            lua_pushnil(L);
-            setuvalue(L, index2value(L, -1), origin->udata);
-            lua_pushnil(L);
-            setsvalue2n(L, index2value(L, -1), key);
-            lua_pushnil(L);
-            setuvalue(L, index2value(L, -1), classOrObj->udata);
-            lua_pushcclosure(L, ObjudataMT__abstractcall, 3);
-            return 1;
+        //之前绑定过就直接复用，代理函数只跟origin/key/level有关
+        Table *cache = origin->boundcache[have_access];
+        if (cache) {
+            const TValue *o = ObjIndex_get(cache, key);
+            if (ttisCclosure(o) && uvalue(&clCvalue(o)->upvalue[2]) == level->classholder->udata) {
+                lua_pushnil(L);
+                setobj2n(L, index2value(L, -1), o);
+                return 1;
+            }
         }
+        //肯定不能直接返回这个方法，因为多态，返回一个代理函数，干__call的活，abstractcall传origin
+        //找方法只用到level这一层的类，存类就够了，对象的父层不用为此建视图
+        lua_pushnil(L);
+        setuvalue(L, index2value(L, -1), origin->udata);
+        lua_pushnil(L);
+        setsvalue2n(L, index2value(L, -1), key);
+        lua_pushnil(L);
+        setuvalue(L, index2value(L, -1), level->classholder->udata);
+        //@final的不会再被覆盖，类体结束后只有一个不限类型的定义时选哪个方法跟参数无关，直接绑定
+        LuaObjMethod *head = ObjIndex_methods(level->methodindex, key);
+        int bindfinal = level->vtable && (head->flags & LUAOBJ_ACCESS_FINAL || level->is_final) &&
+                        !head->overload && !head->argtypes;
+        if (bindfinal) lua_pushlightuserdata(L, head);
+        lua_pushcclosure(L, ObjudataMT__abstractcall, 3 + bindfinal);
+        if (!cache) cache = ObjBound_newcache(L, origin, have_access);
+        ObjIndex_set(L, cache, key, index2value(L, -1));
+        return 1;
     }
+    return 0;
+}
+
+static int ObjudataMT__indexImpl(lua_State *L, LuaObjUData *origin, LuaObjUData *classOrObj, TString *key,
+                                 int have_access) {
+    //查字段
+    LuaObjField *field = ObjIndex_field(classOrObj, key);
+    if (field) return ObjudataMT__indexField(L, origin, classOrObj, field, key, have_access);
+    //查方法（同名重载链）
+    if (ObjudataMT__indexMethod(L, origin, classOrObj, ObjIndex_methods(classOrObj->methodindex, key), key,
+                                have_access))
+        return 1;
     if (have_access && !origin->is_class && luaS_streq(classOrObj->name, key)) {
         //构建函数调用另一个构建函数共同初始化
         lua_pushnil(L);
         setuvalue(L, index2value(L, -1), origin->udata);
         lua_pushnil(L);
         lua_pushnil(L);
-        setuvalue(L, index2value(L, -1), classOrObj->udata);
+        setuvalue(L, index2value(L, -1), classOrObj->classholder->udata);
         lua_pushcclosure(L, ObjudataMT__abstractcall, 3);
         return 1;
     }
     //没找到，试试父类继续往前找
     if (classOrObj->super) {
         LuaObjUData *super = classOrObj->super;
-        return ObjudataMT__indexImpl(L, origin, super, key);
+        return ObjudataMT__indexImpl(L, origin, super, key, have_access);
     } else
         luaG_runerror(L, "field/method '%s' not found", getstr(key));
     return 0;
 }
 
 static int ObjudataMT__index(lua_State *L) {
-    LuaObjUData *classOrObj = (LuaObjUData *) lua_touserdata(L, 1);
+    LuaObjUData *classOrObj = Objudata_get(uvalue(index2value(L, 1)));
     luaL_checktype(L, 2, LUA_TSTRING);
     TString *key = tsvalue(index2value(L, 2));
-    return ObjudataMT__indexImpl(L, classOrObj, classOrObj, key);
+    int have_access = ObjudataMT__access(L, classOrObj);
+    //定义完的类直接查扁平化成员表，找不到或者最近一层的方法都不可访问时再逐层查（构建器名之类的也在那里处理）
+    const TValue *o = ObjIndex_get(classOrObj->vtable, key);
+    if (ttislightuserdata(o)) {
+        FMStruct *member = (FMStruct *) pvalue(o);
+        LuaObjUData *level = ObjLevel(classOrObj, member->self);
+        if (level) {
+            if (member->flags & LUAOBJ_ACCESS_ISFIELD)
+                return ObjudataMT__indexField(L, classOrObj, level, (LuaObjField *) member, key, have_access);
+            if (ObjudataMT__indexMethod(L, classOrObj, level, (LuaObjMethod *) member, key, have_access))
+                return 1;
+        }
+    }
+    return ObjudataMT__indexImpl(L, classOrObj, classOrObj, key, have_access);
 }
 
 static int ObjudataMT__newindex(lua_State *L) {
     lua_settop(L, 3); //R3
     luaL_checktype(L, 1, LUA_TUSERDATA); //R3
     luaL_checktype(L, 2, LUA_TSTRING); //R3
-    LuaObjUData *clazz = (LuaObjUData *) lua_touserdata(L, 1); //R3
+    LuaObjUData *clazz = Objudata_get(uvalue(index2value(L, 1))); //R3
     TString *key = tsvalue(index2value(L, 2)); //R3
     LuaObjUData *curClass = clazz;
-retry:;
-    //遍历fields
-    for (size_t i = 0; i < curClass->size_fields; ++i) {
-        LuaObjField *field = curClass->fields[i];
-        if (luaS_streq(field->name, key)) {
-            if (field->flags & LUAOBJ_ACCESS_CONST && field->initconst)
-                luaG_runerror(L, "const field '%s' cannot be modified", getstr(key));
-            LuaObjAccessFlags flags = field->flags;
-            if (flags & LUAOBJ_ACCESS_PUBLIC) {
-            doset_field:;
-                if (!(flags & LUAOBJ_ACCESS_STATIC) && clazz->is_class) {
-                    luaG_runerror(L, "object field '%s' cannot be modified", getstr(key));
-                }
-                lua_pushnil(L); //R4
-                setuvalue(L, index2value(L, -1), field->udata); //R4
-                lua_pushvalue(L, -2); //R5
-                lua_setiuservalue(L, -2, OBJLUA_UV_fields + 1); //R4
-                lua_pop(L, 1); //R3
-                if (field->flags & LUAOBJ_ACCESS_CONST) field->initconst = 1;
-                return 0;
-            } else if (flags & LUAOBJ_ACCESS_PRIVATE) {
-                int have_access = 0;
-                CallInfo *lastCall = L->ci;
-                if (lastCall && lastCall->previous) lastCall = lastCall->previous; //来到Lua函数层
-                if (lastCall && lastCall->previous) lastCall = lastCall->previous; //来到MethodWrapCall层
-                if (lastCall && ttypetag(s2v(lastCall->func.p)) == LUA_VCCL) {
-                    CClosure *wrapcall = clCvalue(s2v(lastCall->func.p));
-                    if ((Objudata_MethodWrapCall == wrapcall->f ||
-                         Objudata_metaProxy == wrapcall->f)
-                        && wrapcall->nupvalues >= 2) {
-                        //检查是不是类内调用
-                        LuaObjUData *classobj = (LuaObjUData *) getudatamem(uvalue(&wrapcall->upvalue[0]));
-                        if (classobj == clazz || classobj->classholder == clazz->classholder)
-                            have_access = 1;
-                    }
-                }
-                if (!have_access) luaG_runerror(L, "private field '%s' cannot be accessed", getstr(key));
-                goto doset_field;
-            } else luaG_runerror(L, "field not have public or private access");
+    LuaObjField *field = NULL;
+    //定义完的类先查扁平化成员表，最近一层同名的是方法的话还是逐层找字段
+    const TValue *o = ObjIndex_get(clazz->vtable, key);
+    if (ttislightuserdata(o) && (((FMStruct *) pvalue(o))->flags & LUAOBJ_ACCESS_ISFIELD)) {
+        LuaObjField *member = (LuaObjField *) pvalue(o);
+        LuaObjUData *level = ObjLevel(clazz, member->self);
+        if (level) {
+            field = member;
+            curClass = level;
+            goto found_field;
         }
     }
+retry:;
+    //查字段
+    field = ObjIndex_field(curClass, key);
+    if (field) {
+    found_field:;
+        lu_byte *initconst = ObjField_initconst(curClass, field);
+        if (field->flags & LUAOBJ_ACCESS_CONST && *initconst)
+            luaG_runerror(L, "const field '%s' cannot be modified", getstr(key));
+        LuaObjAccessFlags flags = field->flags;
+        if (flags & LUAOBJ_ACCESS_PUBLIC) {
+        doset_field:;
+            if (!(flags & LUAOBJ_ACCESS_STATIC) && clazz->is_class) {
+                luaG_runerror(L, "object field '%s' cannot be modified", getstr(key));
+            }
+            ObjField_set(L, curClass, field, index2value(L, 3)); //R3
+            if (field->flags & LUAOBJ_ACCESS_CONST) *initconst = 1;
+            return 0;
+        } else if (flags & LUAOBJ_ACCESS_PRIVATE) {
+            if (!ObjudataMT__access(L, clazz)) luaG_runerror(L, "private field '%s' cannot be accessed", getstr(key));
+            goto doset_field;
+        } else luaG_runerror(L, "field not have public or private access");
+    }
     //如果是顶层对象或者类，结束
     if (curClass->super == NULL) {
         //__newindex是不支持对非字段的操作的
@@ -761,201 +1294,330 @@ retry:;
     return 0;
 }
 
-static LuaObjUData *makeObject(lua_State *L, LuaObjUData *clazz, TValue *ObjLuaWeakTable, int absLowReg,
-                               int absHighReg) {
-    int GCIDX = 0;
-    int argCount = 0;
-    if (absLowReg <= absHighReg) {
-        argCount = absHighReg - absLowReg + 1;
+/*
+ * 对象父层的视图：用到时才创建，内存里只有一个指向对象块里那一层LuaObjUData的指针，
+ * 元表用那一层的类的，唯一的上值拿着最外层对象，自己挂在最外层对象的viewslot里，两边同生共死
+ */
+Udata *Objudata_udata(lua_State *L, LuaObjUData *classOrObj) {
+    if (l_likely(classOrObj->udata)) return classOrObj->udata;
+    Udata *outer = classOrObj->outer->udata;
+    Table *mt = classOrObj->classholder->udata->metatable;
+    Udata *view = luaS_newudata(L, sizeof(LuaObjUData *), 1);
+    *(LuaObjUData **) getudatamem(view) = classOrObj;
+    view->objlua = OBJLUA_VIEW;
+    view->metatable = mt;
+    setuvalue(L, &view->uv[0].uv, outer);
+    classOrObj->udata = view;
+    setuvalue(L, &outer->uv[classOrObj->viewslot].uv, view);
+    luaC_barrierback(L, obj2gco(outer), &outer->uv[classOrObj->viewslot].uv);
+    luaC_checkfinalizer(L, obj2gco(view), mt);
+    return view;
+}
+
+//const字段回到还没赋过值的状态
+static void ObjLevel_resetconst(LuaObjUData *level) {
+    for (size_t i = 0; i < level->size_fields; ++i) {
+        LuaObjField *field = level->fields[i];
+        if (!(field->flags & LUAOBJ_ACCESS_STATIC)) level->constinit[field->ivslot] = field->initconst;
     }
-    LuaObjUData *obj = lua_newuserdatauv(L, sizeof(LuaObjUData), LuaObjUDataUpValueMinSize); //X+1
+}
+
+//对象块里的一层，照着它的类填，字段描述、方法、索引这些都和类共用
+static void ObjLevel_init(LuaObjUData *level, LuaObjUData *clazz, LuaObjUData *outer, LuaObjUData *super,
+                          size_t slotbase, int viewslot) {
+    level->name = clazz->name; //这时候name通过clazz绑定，clazz绑着obj，就不需要单独绑了
+    level->super = super;
+    level->classholder = clazz;
+    level->is_class = 0; //不是类
+    level->is_final = clazz->is_final;
+    level->size_constructors = clazz->size_constructors;
+    level->constructors = clazz->constructors;
+    level->size_metamethods = clazz->size_metamethods;
+    level->metamethods = clazz->metamethods;
+    level->size_fields = clazz->size_fields;
+    level->fields = clazz->fields;
+    level->nslots = clazz->nslots;
+    level->constinit = (lu_byte *) (outer + outer->depth + 1) + slotbase;
+    ObjLevel_resetconst(level);
+    level->size_methods = clazz->size_methods;
+    level->methods = clazz->methods;
+    level->size_abstractmethods = 0;
+    level->abstractmethods = NULL;
+    level->fieldindex = clazz->fieldindex;
+    level->methodindex = clazz->methodindex;
+    level->metaindex = clazz->metaindex;
+    level->vtable = clazz->vtable;
+    level->fieldinit = clazz->fieldinit;
+    level->boundcache[0] = level->boundcache[1] = NULL; //绑定的是这一层自己，不能共享类的
+    level->nmemo = 0;
+    level->memogen = level->memoepoch = 0;
+    level->classid = clazz->classid;
+    level->depth = clazz->depth;
+    level->display = clazz->display;
+    level->ctorcache = NULL; //用classholder的
+    level->pool = NULL;
+    level->npooled = level->poolmax = 0;
+    level->inpool = 0;
+    level->outer = outer;
+    level->slotbase = slotbase;
+    level->viewslot = viewslot;
+    level->udata = NULL;
+}
+
+/*
+ * 给level这一层的非static字段填初始值：没有初始化器的直接拷贝，其余的由类合成的初始化函数以这一层为self一次填完，
+ * 有初始化函数时把包装好的它压栈返回1，由调用方lua_callk（可以让出）。
+ * 顺序是固定的两步：先拷贝所有直接拷贝的值（@nowrap等），再按定义顺序执行初始化器，
+ * 所以初始化器里读@nowrap字段总能读到值（不管定义在前还是在后），读后面才定义的初始化器字段是nil
+ */
+static int ObjLevel_initfields(lua_State *L, LuaObjUData *level) {
+    int top = lua_gettop(L);
+    int outer = 0;
+    for (size_t i = 0; i < level->size_fields; ++i) {
+        LuaObjField *field = level->fields[i];
+        if (field->flags & LUAOBJ_ACCESS_STATIC) continue;
+        TValue *init = &field->udata->uv[OBJLUA_UV_fields].uv;
+        if (ttisnil(init)) continue; //新对象（以及放回池里的对象）的槽本来就是nil
+        if (!outer) {
+            lua_pushnil(L); //W+1
+            setuvalue(L, index2value(L, -1), level->outer->udata); //W+1
+            outer = lua_gettop(L); //W+1
+        }
+        //@nowrap或者没有初始值的：动态字段初始值直接从原来的拷贝一份
+        lua_pushnil(L); //W+1
+        setobjt2t(L, index2value(L, -1), init); //W+1
+        lua_setiuservalue(L, outer, OBJLUA_UV_slots + 1 + (int) (level->slotbase + field->ivslot)); //W
+    }
+    lua_settop(L, top);
+    if (level->fieldinit == NULL) return 0;
+    lua_pushnil(L); //W+1 临时未完成初始化的对象
+    setuvalue(L, index2value(L, -1), Objudata_udata(L, level)); //W+1
+    lua_pushnil(L); //W+2
+    setclLvalue(L, index2value(L, -1), level->fieldinit); //W+2
+    lua_pushcclosure(L, Objudata_MethodWrapCall, 2); //W+1
+    return 1;
+}
+
+//选出clazz这次要用的构造函数并检查访问权限，类没有定义构造函数返回NULL
+static LuaObjMethod *ObjCtor_select(lua_State *L, LuaObjUData *clazz, int absLowReg, int absHighReg,
+                                    int have_access) {
+    //默认无参构造其实可以改成默认无构造函数自匹配，更人性化
+    if (clazz->size_constructors == 0) return NULL;
+    LuaObjMethod *constructor = polymorphism_overload_method(L, NULL, absLowReg, absHighReg, clazz, 1, 0, 0);
+    if (!constructor) luaG_runerror(L, "constructor not found");
+    LuaObjAccessFlags flags = constructor->flags;
+    if (flags & LUAOBJ_ACCESS_PUBLIC) return constructor;
+    if (flags & LUAOBJ_ACCESS_PRIVATE) {
+        if (!have_access) {
+            lua_pushnil(L);
+            setuvalue(L, index2value(L, -1), clazz->udata);
+            luaL_tolstring(L, -1, NULL);
+            luaG_runerror(L, "private constructor can only be called from '%s'", lua_tostring(L, -1));
+        }
+        return constructor;
+    }
+    luaG_runerror(L, "constructor not have public or private access");
+    return NULL;
+}
+
+//压好以level这一层为self的构造函数和参数（absLowReg到absHighReg），返回参数个数，由调用方lua_callk
+static int ObjCtor_push(lua_State *L, LuaObjUData *level, LuaObjMethod *constructor, int absLowReg,
+                        int absHighReg) {
+    lua_pushnil(L);
+    setuvalue(L, index2value(L, -1), Objudata_udata(L, level));
+    lua_pushnil(L);
+    setuvalue(L, index2value(L, -1), constructor->udata);
+    lua_pushcclosure(L, Objudata_MethodWrapCall, 2);
+    for (int i = absLowReg; i <= absHighReg; ++i) {
+        lua_pushvalue(L, i);
+    }
+    return absLowReg <= absHighReg ? absHighReg - absLowReg + 1 : 0;
+}
+
+static int ObjPool__gc(lua_State *L);
+
+//元表里有没有要执行的__gc（对象池的__gc只在包着类自己定义的__gc时才算）
+static int ObjMeta_hasgc(lua_State *L, Table *mt) {
+    const TValue *tm = fasttm(L, mt, TM_GC);
+    if (tm == NULL) return 0;
+    if (ttisCclosure(tm) && clCvalue(tm)->f == ObjPool__gc) return !ttisnil(&clCvalue(tm)->upvalue[1]);
+    return 1;
+}
+
+/*
+ * 整条继承链只分配一次：obj[0]是对象自己，obj[k]是第k层父对象，后面跟着所有层的const标记，
+ * 字段槽按层排在对象的上值里，再后面是每个父层视图的槽
+ */
+static LuaObjUData *ObjAlloc(lua_State *L, LuaObjUData *clazz) {
+    int depth = clazz->depth;
+    size_t nslots = 0;
+    for (int d = 0; d <= depth; ++d) nslots += clazz->display[d]->nslots;
+    LuaObjUData *obj = lua_newuserdatauv(L, sizeof(LuaObjUData) * (depth + 1) + nslots,
+                                         LuaObjUDataUpValueMinSize + (int) nslots + depth); //X+1
     int retTop = lua_gettop(L); //X+1
-    obj->udata = uvalue(index2value(L, -1)); //X+1
-    //预先准备元表
-    lua_newtable(L); //X+2
-    ObjudataMT__setup(L, retTop + 1); //X+2
+    Udata *u = uvalue(index2value(L, -1)); //X+1
+    u->objlua = OBJLUA_UDATA;
+    obj->depth = depth; //ObjLevel_init算const标记的位置要用
+    size_t slotbase = 0;
+    for (int k = 0; k <= depth; ++k) {
+        LuaObjUData *level = obj + k;
+        LuaObjUData *levelclass = clazz->display[depth - k];
+        ObjLevel_init(level, levelclass, obj, k < depth ? level + 1 : NULL, slotbase,
+                      k ? OBJLUA_UV_slots + (int) nslots + k - 1 : -1);
+        slotbase += levelclass->nslots;
+    }
+    obj->udata = u;
+    //元表直接用类的（元方法代理从参数里找接收者），类和它的所有对象共用一张，TM缓存也一直有效
+    lua_pushnil(L); //X+2
+    sethvalue2s(L, L->top.p - 1, clazz->udata->metatable); //X+2
     lua_setmetatable(L, -2); //X+1
     //创建GC表（承担后续对象GC挂载任务）
     lua_newtable(L); //X+2
     lua_pushvalue(L, -1); //X+3
     lua_setiuservalue(L, -3, OBJLUA_UV_gc + 1); //X+2
-    //clazz挂载进obj的GC
+    //clazz挂载进obj的GC，父类都由clazz的GC表拿着
     lua_pushnil(L); //X+3
     setuvalue(L, index2value(L, -1), clazz->udata); //X+3
-    lua_rawseti(L, -2, ++GCIDX); //X+2
-    obj->name = clazz->name; //这时候name通过clazz绑定，clazz绑着obj，就不需要单独绑了
-    obj->classholder = clazz;
-    obj->is_class = 0; //不是类
-    obj->size_constructors = clazz->size_constructors;
-    obj->constructors = clazz->constructors;
-    obj->size_methods = clazz->size_methods;
-    obj->methods = clazz->methods;
-    if (clazz->super) {
-        LuaObjUData *super_class = clazz->super;
-        lua_pushnil(L); //X+3
-        setuvalue(L, index2value(L, -1), super_class->udata); //X+3
-        for (int i = absLowReg; i <= absHighReg; ++i) {
-            lua_pushvalue(L, i);
-        } //X+3+argCount
-        //call，得到super对象
-        lua_call(L, argCount, 1); //X+3
-        obj->super = lua_touserdata(L, -1); //X+3
-        GCIDX = luaL_len(L, -2); //GCIDX内部可能已经被添加
-        //挂载父对象到自己GC
-        lua_rawseti(L, -2, ++GCIDX); //X+2
-    } else {
-        //自己就是顶级class
-        obj->super = NULL;
+    lua_rawseti(L, -2, 1); //X+2
+    lua_settop(L, retTop); //X+1
+    //父层的类定义了__gc的，视图要先建好，不然它的__gc就没机会执行了
+    for (int k = 1; k <= depth; ++k) {
+        if (ObjMeta_hasgc(L, obj[k].classholder->udata->metatable)) Objudata_udata(L, obj + k);
+    }
+    return obj;
+}
+
+//对象占用的字段槽数（所有层的，不含父层视图的槽）
+#define ObjPool_nslots(obj) ((int) (obj)->udata->nuvalue - LuaObjUDataUpValueMinSize - (obj)->depth)
+
+//把obj放回它的类的对象池，字段先清空，免得池里的对象还拿着别的对象；没开启、池满了或者已经在池里返回0
+static int ObjPool_put(lua_State *L, LuaObjUData *obj) {
+    LuaObjUData *clazz = obj->classholder;
+    if (obj->inpool || clazz->npooled >= clazz->poolmax) return 0;
+    Udata *u = obj->udata;
+    for (int i = 0; i < ObjPool_nslots(obj); ++i)
+        setnilvalue(&u->uv[OBJLUA_UV_slots + i].uv);
+    TValue v;
+    setuvalue(L, &v, u);
+    luaH_setint(L, clazz->pool, (lua_Integer) ++clazz->npooled, &v);
+    luaC_barrierback(L, obj2gco(clazz->pool), &v);
+    obj->inpool = 1;
+    return 1;
+}
+
+//从对象池里拿一个对象压栈，状态回到刚分配完的样子（字段由ObjNew_step重新初始化）
+static LuaObjUData *ObjPool_take(lua_State *L, LuaObjUData *clazz) {
+    TValue nil;
+    Udata *u = uvalue(luaH_getint(clazz->pool, (lua_Integer) clazz->npooled));
+    setnilvalue(&nil);
+    luaH_setint(L, clazz->pool, (lua_Integer) clazz->npooled--, &nil);
+    lua_pushnil(L); //X+1
+    setuvalue(L, index2value(L, -1), u); //X+1
+    LuaObjUData *obj = Objudata_get(u);
+    obj->inpool = 0;
+    for (int k = 0; k <= obj->depth; ++k) ObjLevel_resetconst(obj + k);
+    Objudata_clearmemo(L, obj); //上一个对象的结果不能带过来
+    //上次的__gc已经执行过了，要重新登记才会再次回到池里
+    luaC_checkfinalizer(L, obj2gco(u), u->metatable);
+    return obj;
+}
+
+//开启了对象池的类的__gc：先执行类自己定义的__gc，再把对象复活放回池里，父层视图和类本身不管
+static int ObjPool__gc(lua_State *L) {
+    LuaObjUData *clazz = (LuaObjUData *) lua_touserdata(L, lua_upvalueindex(1));
+    if (!lua_isnil(L, lua_upvalueindex(2))) {
+        lua_pushvalue(L, lua_upvalueindex(2));
+        lua_pushvalue(L, 1);
+        lua_call(L, 1, 0);
+    }
+    const TValue *o = index2value(L, 1);
+    if (!ttisfulluserdata(o) || uvalue(o)->objlua != OBJLUA_UDATA) return 0;
+    LuaObjUData *obj = Objudata_get(uvalue(o));
+    if (!obj->is_class && obj->classholder == clazz) ObjPool_put(L, obj);
+    return 0;
+}
+
+//开启/调整clazz的对象池，max为0就是关闭（已经在池里的对象放掉）
+void Objudata_setpool(lua_State *L, LuaObjUData *clazz, size_t max) {
+    if (clazz->pool == NULL) {
+        lua_pushnil(L); //R1
+        setuvalue(L, index2value(L, -1), clazz->udata); //R1
+        //池挂在类的GC表里
+        lua_getiuservalue(L, -1, OBJLUA_UV_gc + 1); //R2
+        int GCIDX = luaL_len(L, -1); //R2
+        lua_newtable(L); //R3
+        clazz->pool = hvalue(index2value(L, -1)); //R3
+        lua_rawseti(L, -2, ++GCIDX); //R2
+        //__gc换成对象池的，类自己定义的__gc（元方法代理）由它先调用
+        lua_getmetatable(L, -2); //R3
+        lua_pushliteral(L, "__gc"); //R4
+        lua_pushvalue(L, -4); //R5 clazz
+        lua_pushliteral(L, "__gc"); //R6
+        lua_rawget(L, -4); //R6
+        lua_pushcclosure(L, ObjPool__gc, 2); //R5
+        lua_rawset(L, -3); //R3
+        lua_pop(L, 3); //R0
     }
-    //元方法需要重新自定义绑定……而且因为元表问题只能错后在定义元表之后，所以干脆都做完之后再设置，现在X+2
-    //因为字段需要，提高到字段定义前面，不是最最后
-    obj->size_metamethods = 0;
-    obj->metamethods = NULL;
-    for (size_t i = 0; i < clazz->size_metamethods; ++i) {
-        LuaObjMethod *metamethod = clazz->metamethods[i];
-        lua_pushcfunction(L, Objudata_DefMetaMethod); //X+3 需要三个参数:clazz,method,method_name
-        lua_pushvalue(L, -3); //X+4 obj
-        lua_pushnil(L); //X+5
-        setuvalue(L, index2value(L, -1), metamethod->udata); //X+5 method
-        lua_pushnil(L); //X+6
-        setsvalue2n(L, index2value(L, -1), metamethod->name); //X+6 method_name
-        lua_call(L, 3, 0); //X+2
+    clazz->poolmax = max;
+    while (clazz->npooled > max) {
+        TValue nil;
+        Udata *u = uvalue(luaH_getint(clazz->pool, (lua_Integer) clazz->npooled));
+        Objudata_get(u)->inpool = 0;
+        setnilvalue(&nil);
+        luaH_setint(L, clazz->pool, (lua_Integer) clazz->npooled--, &nil);
     }
-    obj->size_abstractmethods = 0;
-    obj->abstractmethods = NULL;
-    //字段很特殊，不能像方法一样直接复制，非static的字段那就是独立的……
-    obj->size_fields = 0;
-    obj->fields = NULL;
-    for (size_t i = 0; i < clazz->size_fields; ++i) {
-        LuaObjField *field = clazz->fields[i];
-        const LuaObjAccessFlags flags = field->flags;
-        if (flags & LUAOBJ_ACCESS_STATIC) {
-            //最方便的一个情况
-            lua_pushcfunction(L, Objudata_DefField); //X+3 需要三个参数:clazz,field,deffield
-            lua_pushvalue(L, -3); //X+4 obj
-            lua_pushnil(L); //X+5
-            setuvalue(L, index2value(L, -1), field->udata); //X+5 field
-            lua_pushboolean(L, 0); //X+6
-            lua_call(L, 3, 0); //X+2
-        } else {
-            int curTop = lua_gettop(L); //Y
-            int FGCIDX = 0;
-            LuaObjField *obj_field = lua_newuserdatauv(L, sizeof(LuaObjField), LuaObjFieldUpValueMinSize); //Y+1
-            obj_field->name = field->name;
-            obj_field->self = obj;
-            obj_field->flags = field->flags;
-            obj_field->initconst = field->initconst;
-            obj_field->udata = uvalue(index2value(L, -1)); //Y+1
-            if (obj_field->flags & LUAOBJ_ACCESS_NOWRAP) {
-                ///旧版方案：动态字段初始值直接从原来的拷贝一份
-            setnowrap:;
-                lua_pushnil(L); //Y+2
-                setobjt2t(L, index2value(L, -1), &field->udata->uv[OBJLUA_UV_fields].uv); //Y+2
-            } else {
-                ///新版将会自动调用一次字段的函数
-                if (ttype(&field->udata->uv[OBJLUA_UV_fields].uv) == LUA_TFUNCTION) {
-                    //Y+1
-                    //如果是函数，说明需要执行一次才能得到内容
-
-                    // * upval[2]:LuaObjMethod/LClosure
-                    lua_pushvalue(L, retTop); //Y+2 临时未完成初始化的对象
-                    lua_pushnil(L); // Y+3
-                    setobjt2t(L, index2value(L, -1), &field->udata->uv[OBJLUA_UV_fields].uv); //Y+3
-                    lua_pushcclosure(L, Objudata_MethodWrapCall, 2); //Y+2
-                    lua_call(L, 0, 1); //Y+1
-                } else goto setnowrap;
+}
+
+//手动把不再使用的对象放回对象池，放进去了返回1
+int Objudata_release(lua_State *L, LuaObjUData *obj) {
+    return ObjPool_put(L, obj);
+}
+
+/*
+ * 构造顺序和一层层构造时一样：从最顶层开始，每层先初始化字段再执行它的构造函数（参数相同），
+ * 其中的Lua调用都用lua_callk，构造函数/字段初始化函数里让出之后从这里接着做下一步：
+ * 从最顶层数第i层，step为2*i时选构造函数并初始化字段，2*i+1时执行构造函数
+ * 栈：类 参数... 对象 自己这一层的构造函数 当前父层的构造函数（没有的都是nil）
+ */
+static int ObjNew_step(lua_State *L, int status, lua_KContext step) {
+    (void) status;
+    int nargs = lua_gettop(L) - 4;
+    LuaObjUData *obj = Objudata_get(uvalue(index2value(L, nargs + 2)));
+    for (; (int) (step >> 1) <= obj->depth; ++step) {
+        LuaObjUData *level = obj + obj->depth - (int) (step >> 1);
+        if (!(step & 1)) {
+            if (level != obj) {
+                //父层的构造函数不是从类内调用的，private的选不上
+                lua_pushlightuserdata(L, ObjCtor_select(L, level->classholder, 2, 1 + nargs, 0));
+                lua_replace(L, nargs + 4);
             }
-            lua_setiuservalue(L, -2, OBJLUA_UV_fields + 1); //Y+1
-
-            // lua_pushnil(L); //T+2
-            // lua_setiuservalue(L, -2, OBJLUA_UV_fields + 1); //Y+1
-            //创建GC表（承担后续对象GC挂载任务）
-            lua_newtable(L); //Y+2
-            lua_pushvalue(L, -1); //Y+3
-            lua_setiuservalue(L, -3, OBJLUA_UV_gc + 1); //Y+2
-            //字段名在field已经绑了，InstanceField->Object->Class->ClassField一路指向，所以只需要绑self，偷点懒
-            //同样的，绑定关系的类也需要绑定在GC表里
-            lua_pushvalue(L, retTop); //Y+3 obj
-            lua_rawseti(L, -2, ++FGCIDX); //Y+2
-            //字段自己本身应该绑在clazz的GC表里，并且添加进列表，这一步进行封装使用
-            lua_pushcfunction(L, Objudata_DefField); //Y+3 需要三个参数:clazz,field,deffield
-            lua_pushvalue(L, retTop); //Y+4 clazz
-            lua_pushvalue(L, -4); //Y+5 field
-            lua_pushboolean(L, 1); //Y+6
-            lua_call(L, 3, 0); //Y+2
-            lua_settop(L, curTop); //Y=X+2
+            if (ObjLevel_initfields(L, level)) lua_callk(L, 0, 0, step + 1, ObjNew_step);
+        } else {
+            LuaObjMethod *constructor = lua_touserdata(L, level == obj ? nargs + 3 : nargs + 4);
+            if (constructor)
+                lua_callk(L, ObjCtor_push(L, level, constructor, 2, 1 + nargs), 0, step + 1, ObjNew_step);
         }
     }
-    // lua_pop(L, 1); //剩下GC绑定有相关内部代码完成，这个GC表就可以弹出了
-    lua_settop(L, retTop); //X+1
-    //都初始化完毕，挂载到弱表
-    lua_getfield(L, LUA_REGISTRYINDEX, OBJLUA_WEAK_TABLE); //X+2
-    lua_pushvalue(L, -2); //X+3 obj
-    lua_pushboolean(L, 1); //X+4
-    lua_rawset(L, -3); //X+2
-    lua_pop(L, 1); //X+1
-    return obj;
+    lua_settop(L, nargs + 2);
+    return 1;
 }
 
-
 /*
- * 顶级Class:字段|方法|名字的GC，回收交给自然的对外的访问，挂载弱表
- * 顶级Object:字段|方法|名字没有挂载GC，直接用顶级Class，所以把顶级Class挂载自己的GC，回收交给自然的对外的访问，挂载弱表
- * 子Class:字段|方法|名字挂载GC，同时把super挂载进GC保持引用，回收交给自然的对外的访问，挂载弱表
- * 子Object:字段|方法|名字没有挂载GC，直接用子Class，所以把super挂载自己的GC，回收交给自然的对外的访问，挂载弱表
+ * 顶级Class:字段|方法|名字的GC，回收交给自然的对外的访问
+ * 顶级Object:字段|方法|名字没有挂载GC，直接用顶级Class，所以把顶级Class挂载自己的GC，回收交给自然的对外的访问
+ * 子Class:字段|方法|名字挂载GC，同时把super挂载进GC保持引用，回收交给自然的对外的访问
+ * 子Object:所有父对象都在自己这块内存里，父层视图挂在自己的上值里，类挂载自己的GC，回收交给自然的对外的访问
  */
 static int ObjudataMT__call(lua_State *L) {
-    LuaObjUData *clazz = (LuaObjUData *) lua_touserdata(L, 1);
+    LuaObjUData *clazz = Objudata_get(uvalue(index2value(L, 1)));
     if (!clazz->is_class) luaG_runerror(L, "only class can call constructors");
     int nargs = lua_gettop(L) - 1;
-    ObjWeakTableGet(L);
-    if (clazz->size_constructors == 0) {
-        //默认无参构造其实可以改成默认无构造函数自匹配，更人性化
-        LuaObjUData *obj = makeObject(L, clazz, ObjLuaWeakTable, 2, 1 + nargs);
-        return 1;
-    } else {
-        //遍历constructors
-        LuaObjMethod *constructor = polymorphism_overload_method(L, NULL, 2, 1 + nargs, clazz, 1, 0, 0);
-        if (constructor) {
-            LuaObjAccessFlags flags = constructor->flags;
-            if (flags & LUAOBJ_ACCESS_PUBLIC) {
-            make_obj:;
-                LuaObjUData *obj = makeObject(L, clazz, ObjLuaWeakTable, 2, 1 + nargs);
-                lua_pushvalue(L, -1); //最终返回的值
-                lua_pushnil(L);
-                TValue *o = index2value(L, -1);
-                setuvalue(L, o, constructor->udata);
-                lua_pushcclosure(L, Objudata_MethodWrapCall, 2);
-                for (int i = 1; i <= nargs; ++i) {
-                    lua_pushvalue(L, 1 + i);
-                }
-                lua_call(L, nargs, 0);
-                return 1;
-            } else if (flags & LUAOBJ_ACCESS_PRIVATE) {
-                int have_access = 0;
-                CallInfo *lastCall = L->ci;
-                if (lastCall && lastCall->previous) lastCall = lastCall->previous; //来到Lua函数层
-                if (lastCall && lastCall->previous) lastCall = lastCall->previous; //来到MethodWrapCall层
-                if (lastCall && ttypetag(s2v(lastCall->func.p)) == LUA_VCCL) {
-                    CClosure *wrapcall = clCvalue(s2v(lastCall->func.p));
-                    if ((Objudata_MethodWrapCall == wrapcall->f ||
-                         Objudata_metaProxy == wrapcall->f)
-                        && wrapcall->nupvalues >= 2) {
-                        //检查是不是类内调用
-                        LuaObjUData *classobj = (LuaObjUData *) getudatamem(uvalue(&wrapcall->upvalue[0]));
-                        if (classobj == clazz || classobj->classholder == clazz->classholder)
-                            have_access = 1;
-                    }
-                }
-                if (!have_access) {
-                    luaL_tolstring(L, 1, NULL);
-                    luaG_runerror(L, "private constructor can only be called from '%s'", lua_tostring(L, -1));
-                }
-                goto make_obj;
-            } else luaG_runerror(L, "constructor not have public or private access");
-        } else luaG_runerror(L, "constructor not found");
-    }
-    return 0;
+    LuaObjMethod *constructor = ObjCtor_select(L, clazz, 2, 1 + nargs, ObjudataMT__access(L, clazz));
+    //开启了对象池并且池里有对象就直接复用，否则整条继承链一次分配
+    if (clazz->npooled) ObjPool_take(L, clazz); else ObjAlloc(L, clazz);
+    lua_pushlightuserdata(L, constructor);
+    lua_pushnil(L);
+    return ObjNew_step(L, LUA_OK, 0);
 }
 
 static int ObjudataMT__setup(lua_State *L, int idx) {
@@ -1000,11 +1662,30 @@ int Objudata_MethodWrapCall(lua_State *L) {
     setclLvalue(L, o, func);
     lua_insert(L, 1);
     // func [self] [super] arg1 arg2 ...
-    lua_call(L, nargs + 2, LUA_MULTRET);
-    return lua_gettop(L);
+    lua_callk(L, nargs + 2, LUA_MULTRET, 0, ObjWrap_finish);
+    return ObjWrap_finish(L, LUA_OK, 0);
 }
 
 
+/*
+ * 成员数组（类的uv里的userdata）追加一项，容量就是那个userdata的大小，不够时按两倍扩容，
+ * 这样定义n个成员总共只拷贝O(n)次，不会每加一个就整份重新分配一遍
+ * idx:类在栈上的位置
+ */
+static void **ObjArray_push(lua_State *L, int idx, int uv, void **array, size_t *size, void *item) {
+    Udata *u = uvalue(index2value(L, idx));
+    const TValue *old = &u->uv[uv].uv;
+    if (!ttisfulluserdata(old) || uvalue(old)->len < (*size + 1) * sizeof(void *)) {
+        size_t capacity = *size < 4 ? 4 : *size * 2;
+        void **newarray = lua_newuserdatauv(L, sizeof(void *) * capacity, 0);
+        if (*size) memcpy(newarray, array, sizeof(void *) * *size);
+        lua_setiuservalue(L, idx, uv + 1);
+        array = newarray;
+    }
+    array[(*size)++] = item;
+    return array;
+}
+
 /*
  * arg1:LuaObjUData *clazz
  * arg2:LuaObjMethod *constructor
@@ -1021,39 +1702,80 @@ int Objudata_DefConstructor(lua_State *L) {
     lua_pushvalue(L, -2); //R4 Constructor
     lua_rawseti(L, -2, ++CLASS_GCIDX); //R3
     lua_pop(L, 1); //R2
-    //扩容赋值，然后把原来OBJLUA_UV_constructors内存更换
-    LuaObjMethod **newconstructors = lua_newuserdatauv(L, sizeof(LuaObjMethod *) * (clazz->size_constructors + 1), 0);
-    //R3
-    memcpy(newconstructors, clazz->constructors, sizeof(LuaObjMethod *) * clazz->size_constructors);
-    newconstructors[clazz->size_constructors++] = constructor;
-    clazz->constructors = newconstructors;
-    lua_setiuservalue(L, 1, OBJLUA_UV_constructors + 1); //R2
+    //追加进OBJLUA_UV_constructors，容量不够才换内存
+    clazz->constructors = (LuaObjMethod **) ObjArray_push(L, 1, OBJLUA_UV_constructors, (void **) clazz->constructors,
+                                                          &clazz->size_constructors, constructor); //R2
     return 0;
 }
 
+//元方法的接收者：前两个参数里第一个属于这个类（类自己或者它的对象）的
+static LuaObjUData *ObjMeta_receiver(lua_State *L, LuaObjUData *clazz, StkId args, int nargs) {
+    for (int i = 0; i < 2 && i < nargs; ++i) {
+        const TValue *o = s2v(args + i);
+        if (!ttisfulluserdata(o)) continue;
+        const TValue *tm = fasttm(L, uvalue(o)->metatable, TM_INDEX);
+        if (tm == NULL || !ttislcf(tm) || fvalue(tm) != ObjudataMT__index) continue;
+        LuaObjUData *classOrObj = Objudata_get(uvalue(o));
+        if (classOrObj->classholder == clazz) return classOrObj;
+    }
+    return NULL;
+}
+
 int Objudata_metaProxy(lua_State *L) {
-    //uv0:LuaObjUData->classOrObj uv1:TString->metamethodname
-    LuaObjUData *classOrObj = (LuaObjUData *) lua_touserdata(L, lua_upvalueindex(1));
+    //uv0:LuaObjUData->clazz uv1:TString->metamethodname
+    //类和它的对象共用元表，所以代理只认类，接收者从参数里找
+    LuaObjUData *clazz = (LuaObjUData *) lua_touserdata(L, lua_upvalueindex(1));
     TString *metaname = tsvalue(index2value(L, lua_upvalueindex(2)));
-    lua_remove(L, 1);
-    int nargs = lua_gettop(L);
-    LuaObjMethod *metamethod = polymorphism_overload_method(L, metaname, 1, nargs, classOrObj, 0, 1, 1);
+    LuaObjUData *classOrObj = ObjMeta_receiver(L, clazz, L->ci->func.p + 1, lua_gettop(L));
+    if (classOrObj == NULL) luaG_runerror(L, "metamethod '%s' called without receiver", getstr(metaname));
+    //第一个参数换成接收者留在栈底，Objudata_methodinit从这里拿self
+    lua_pushnil(L);
+    setuvalue(L, index2value(L, -1), classOrObj->udata);
+    lua_replace(L, 1);
+    int nargs = lua_gettop(L) - 1;
+    LuaObjMethod *metamethod = polymorphism_overload_method(L, metaname, 2, nargs + 1, classOrObj, 0, 1, 1);
     if (metamethod) {
         LClosure *func = metamethod->func;
         //self/super需要预留好空间，因为寄存器初始分配因为包装接管了
-        lua_pushnil(L), lua_insert(L, 1);
-        lua_pushnil(L), lua_insert(L, 1);
+        lua_pushnil(L), lua_insert(L, 2);
+        lua_pushnil(L), lua_insert(L, 2);
         lua_pushnil(L);
         TValue *o = index2value(L, -1);
         setclLvalue(L, o, func);
-        lua_insert(L, 1);
-        // func [self] [super] arg1 arg2 ...
-        lua_call(L, nargs + 2, LUA_MULTRET);
-        return lua_gettop(L);
+        lua_insert(L, 2);
+        // receiver func [self] [super] arg1 arg2 ...
+        lua_callk(L, nargs + 2, LUA_MULTRET, 1, ObjWrap_finish);
+        return ObjWrap_finish(L, LUA_OK, 1);
     } else luaG_runerror(L, "metamethod '%s' not found", getstr(metaname));
     return 0;
 }
 
+/*
+ * 元方法代理的Objudata_bind：和Objudata_metaProxy选的一样（第一个参数换成接收者，方法参数从第二个开始），
+ * proxy arg1 arg2 ... 原地变成 func self super arg2 ...，元方法直接是一个Lua帧，不经过代理的C帧
+ */
+static StkId ObjMeta_bind(lua_State *L, StkId func) {
+    CClosure *proxy = clCvalue(s2v(func));
+    LuaObjUData *clazz = Objudata_get(uvalue(&proxy->upvalue[0]));
+    TString *metaname = tsvalue(&proxy->upvalue[1]);
+    int nargs = cast_int(L->top.p - func) - 1;
+    LuaObjUData *self = ObjMeta_receiver(L, clazz, func + 1, nargs);
+    if (self == NULL) luaG_runerror(L, "metamethod '%s' called without receiver", getstr(metaname));
+    LuaObjMethod *metamethod = polymorphism_overload_args(L, metaname, func + 2, nargs - 1, self, 0, 1, 1);
+    if (metamethod == NULL) luaG_runerror(L, "metamethod '%s' not found", getstr(metaname));
+    checkstackGCp(L, 1, func); //接收者还在参数里，GC不会收走self
+    for (StkId p = L->top.p - 1; p > func + 1; p--)
+        setobjs2s(L, p + 1, p);
+    L->top.p++;
+    setclLvalue2s(L, func, metamethod->func);
+    setuvalue(L, s2v(func + 1), self->udata);
+    if (self->super) {
+        setuvalue(L, s2v(func + 2), Objudata_udata(L, self->super));
+    } else
+        setnilvalue(s2v(func + 2));
+    return func;
+}
+
 /*
  * arg1:LuaObjUData *clazz
  * arg2:LuaObjMethod *metamethod
@@ -1083,19 +1805,16 @@ int Objudata_DefMetaMethod(lua_State *L) {
     lua_pushvalue(L, -3); //R5 MetaMethod
     lua_rawseti(L, -2, ++CLASS_GCIDX); //R4
     lua_pop(L, 1); //R3
-    //扩容赋值，然后把原来OBJLUA_UV_metamethods内存更换
-    LuaObjMethod **newmetamethods = lua_newuserdatauv(L, sizeof(LuaObjMethod *) * (clazz->size_metamethods + 1), 0);
-    //R4
-    memcpy(newmetamethods, clazz->metamethods, sizeof(LuaObjMethod *) * clazz->size_metamethods);
-    newmetamethods[clazz->size_metamethods++] = metamethod;
-    clazz->metamethods = newmetamethods;
-    lua_setiuservalue(L, 1, OBJLUA_UV_metamethods + 1); //R3
+    //追加进OBJLUA_UV_metamethods，容量不够才换内存
+    clazz->metamethods = (LuaObjMethod **) ObjArray_push(L, 1, OBJLUA_UV_metamethods, (void **) clazz->metamethods,
+                                                         &clazz->size_metamethods, metamethod); //R3
+    ObjIndex_addmethod(L, clazz->metaindex, metamethod);
     //还需要额外为其设置元表的代理（这时候不方便操作堆栈只能过来直接定义），直接覆盖就完事了，原内容失去引用就回收了
     lua_getmetatable(L, 1); //R4 classOrObj的元表
     Table *mt = hvalue(index2value(L,-1));
     lua_pushvalue(L, 3); //R6 metaname
-    //uv0:LuaObjUData->classOrObj uv1:TString->metamethodname
-    lua_pushvalue(L, 1); //R7 classOrObj
+    //uv0:LuaObjUData->clazz uv1:TString->metamethodname
+    lua_pushvalue(L, 1); //R7 clazz
     lua_pushvalue(L, 3); //R8 metaname
     lua_pushcclosure(L, Objudata_metaProxy, 2); //R6
     lua_rawset(L, -3); //R4
@@ -1125,12 +1844,17 @@ int Objudata_DefField(lua_State *L) {
         lua_rawseti(L, -2, ++CLASS_GCIDX); //R4
         lua_pop(L, 1); //R3
     }
-    //fields扩容赋值，然后把原来OBJLUA_UV_fields内存更换
-    LuaObjField **newfields = lua_newuserdatauv(L, sizeof(LuaObjField *) * (clazz->size_fields + 1), 0); //R4
-    memcpy(newfields, clazz->fields, sizeof(LuaObjField *) * clazz->size_fields);
-    newfields[clazz->size_fields++] = field;
-    clazz->fields = newfields;
-    lua_setiuservalue(L, 1, OBJLUA_UV_fields + 1); //R3
+    //追加进OBJLUA_UV_fields，容量不够才换内存
+    clazz->fields = (LuaObjField **) ObjArray_push(L, 1, OBJLUA_UV_fields, (void **) clazz->fields,
+                                                   &clazz->size_fields, field); //R3
+    if (clazz->is_class) {
+        //对象直接用类的fields，只有类需要登记索引和分配对象槽位
+        TValue v;
+        field->slot = clazz->size_fields - 1;
+        if (!(field->flags & LUAOBJ_ACCESS_STATIC)) field->ivslot = clazz->nslots++;
+        setivalue(&v, clazz->size_fields - 1);
+        ObjIndex_set(L, clazz->fieldindex, field->name, &v);
+    }
     return 0;
 }
 
@@ -1151,12 +1875,10 @@ int Objudata_DefMethod(lua_State *L) {
     lua_pushvalue(L, -2); //R4 Method
     lua_rawseti(L, -2, ++CLASS_GCIDX); //R3
     lua_pop(L, 1); //R2
-    //扩容赋值，然后把原来OBJLUA_UV_methods内存更换
-    LuaObjMethod **newmethods = lua_newuserdatauv(L, sizeof(LuaObjMethod *) * (clazz->size_methods + 1), 0); //R3
-    memcpy(newmethods, clazz->methods, sizeof(LuaObjMethod *) * clazz->size_methods);
-    newmethods[clazz->size_methods++] = method;
-    clazz->methods = newmethods;
-    lua_setiuservalue(L, 1, OBJLUA_UV_methods + 1); //R2
+    //追加进OBJLUA_UV_methods，容量不够才换内存
+    clazz->methods = (LuaObjMethod **) ObjArray_push(L, 1, OBJLUA_UV_methods, (void **) clazz->methods,
+                                                     &clazz->size_methods, method); //R2
+    ObjIndex_addmethod(L, clazz->methodindex, method);
     return 0;
 }
 
@@ -1176,13 +1898,10 @@ LUAI_FUNC int Objudata_DefAbstractMethod(lua_State *L) {
     lua_pushvalue(L, -2); //R4 Method
     lua_rawseti(L, -2, ++CLASS_GCIDX); //R3
     lua_pop(L, 1); //R2
-    //扩容赋值，然后把原来OBJLUA_UV_abstractmethods内存更换
-    LuaObjMethod **newabstractmethods = lua_newuserdatauv(L, sizeof(LuaObjMethod *) * (clazz->size_abstractmethods + 1),
-                                                          0); //R3
-    memcpy(newabstractmethods, clazz->abstractmethods, sizeof(LuaObjMethod *) * clazz->size_abstractmethods);
-    newabstractmethods[clazz->size_abstractmethods++] = method;
-    clazz->abstractmethods = newabstractmethods;
-    lua_setiuservalue(L, 1, OBJLUA_UV_abstractmethods + 1); //R2
+    //追加进OBJLUA_UV_abstractmethods，容量不够才换内存
+    clazz->abstractmethods = (LuaObjMethod **) ObjArray_push(L, 1, OBJLUA_UV_abstractmethods,
+                                                             (void **) clazz->abstractmethods,
+                                                             &clazz->size_abstractmethods, method); //R2
     return 0;
 }
 
@@ -1193,3 +1912,134 @@ inline int luaS_streq(TString *left, TString *right) {
     else if (left->tt == LUA_VSHRSTR) return eqshrstr(left, right);
     else return luaS_eqlngstr(left, right);
 }
+
+
+/*
+ * VM内联缓存（OP_GETFIELD/OP_SETFIELD/OP_SELF遇到完整userdata时），每条指令一个，挂在Proto上懒分配
+ * 以接收者的类编号为键（编号不复用，类被回收了也不会误中）：
+ * 字段记住所在的类和下标，命中时直接读写字段的值；private字段要求这次也是类内访问
+ * 方法命中时按类内访问结果直接从接收者的boundcache取代理函数
+ * 未命中时只尝试填缓存并返回0，这次访问仍然走__index/__newindex（报错也都在那边）
+ * __index/__newindex被元方法接管的不缓存
+ */
+static LuaObjUData *ObjIC_receiver(lua_State *L, const TValue *o, TMS event, lua_CFunction f) {
+    const TValue *tm = fasttm(L, uvalue(o)->metatable, event);
+    if (tm == NULL || !ttislcf(tm) || fvalue(tm) != f) return NULL;
+    return Objudata_get(uvalue(o));
+}
+
+static ObjInlineCache *ObjIC_get(lua_State *L, CallInfo *ci) {
+    Proto *p = ci_func(ci)->p;
+    if (p->objic == NULL) {
+        p->objic = luaM_newvector(L, p->sizecode, ObjInlineCache);
+        memset(p->objic, 0, sizeof(ObjInlineCache) * p->sizecode);
+    }
+    return &p->objic[pcRel(ci->u.l.savedpc, p)];
+}
+
+static int ObjIC_hit(ObjInlineCache *ic, LuaObjUData *obj) {
+    return ic->classid == obj->classid && ic->isclass == obj->is_class;
+}
+
+//缓存一个可直接读写的字段，const/类上访问对象字段之类需要报错或特殊处理的都不缓存
+static void ObjIC_fillfield(ObjInlineCache *ic, LuaObjUData *obj, LuaObjField *field, int forset) {
+    LuaObjAccessFlags flags = field->flags;
+    if (!(flags & (LUAOBJ_ACCESS_PUBLIC | LUAOBJ_ACCESS_PRIVATE))) return;
+    if (!(flags & LUAOBJ_ACCESS_STATIC) && obj->is_class) return;
+    if (forset && flags & LUAOBJ_ACCESS_CONST) return;
+    ic->classid = obj->classid;
+    ic->isclass = obj->is_class;
+    ic->kind = OBJIC_FIELD;
+    ic->level = field->self;
+    ic->slot = field->slot;
+    ic->access = (flags & LUAOBJ_ACCESS_PRIVATE) != 0;
+}
+
+//ci必须已经savepc
+int Objudata_icget(lua_State *L, CallInfo *ci, const TValue *o, TString *key, StkId ra) {
+    LuaObjUData *obj = ObjIC_receiver(L, o, TM_INDEX, ObjudataMT__index);
+    if (!obj) return 0;
+    ObjInlineCache *ic = ObjIC_get(L, ci);
+    if (ObjIC_hit(ic, obj)) {
+        if (ic->kind == OBJIC_FIELD) {
+            if (!ic->access || Objudata_access(ci, obj)) {
+                LuaObjUData *level = ObjLevel(obj, ic->level);
+                setobj2s(L, ra, ObjField_value(level, level->fields[ic->slot]));
+                return 1;
+            }
+        } else {
+            const TValue *bound = ObjIndex_get(obj->boundcache[Objudata_access(ci, obj)], key);
+            if (ttisCclosure(bound)) {
+                setobj2s(L, ra, bound);
+                return 1;
+            }
+        }
+    }
+    //未命中，按扁平化成员表重新填（类还没定义完时没有）
+    const TValue *m = ObjIndex_get(obj->vtable, key);
+    if (!ttislightuserdata(m)) return 0;
+    FMStruct *member = (FMStruct *) pvalue(m);
+    if (member->flags & LUAOBJ_ACCESS_ISFIELD) {
+        ObjIC_fillfield(ic, obj, (LuaObjField *) member, 0);
+    } else {
+        //代理函数由这次__index放进boundcache，下次命中直接取
+        ic->classid = obj->classid;
+        ic->isclass = obj->is_class;
+        ic->kind = OBJIC_METHOD;
+    }
+    return 0;
+}
+
+//ci必须已经savepc
+int Objudata_icset(lua_State *L, CallInfo *ci, const TValue *o, TString *key, const TValue *val) {
+    LuaObjUData *obj = ObjIC_receiver(L, o, TM_NEWINDEX, ObjudataMT__newindex);
+    if (!obj) return 0;
+    ObjInlineCache *ic = ObjIC_get(L, ci);
+    if (ObjIC_hit(ic, obj) && ic->kind == OBJIC_FIELD && (!ic->access || Objudata_access(ci, obj))) {
+        LuaObjUData *level = ObjLevel(obj, ic->level);
+        ObjField_set(L, level, level->fields[ic->slot], val);
+        return 1;
+    }
+    const TValue *m = ObjIndex_get(obj->vtable, key);
+    if (ttislightuserdata(m) && ((FMStruct *) pvalue(m))->flags & LUAOBJ_ACCESS_ISFIELD)
+        ObjIC_fillfield(ic, obj, (LuaObjField *) pvalue(m), 1);
+    return 0;
+}
+
+/*
+ * 方法里self.字段的槽位是编译期按类的声明顺序定的，只有接收者的那一层类里这个字段正好在这个槽位才能直接用
+ * 命中时返回值所在的槽（owner是屏障要用的最外层对象），否则返回NULL走OP_GETFIELD/OP_SETFIELD同样的路
+ * ci必须已经savepc
+ */
+TValue *Objudata_slot(lua_State *L, CallInfo *ci, const TValue *o, TString *key, int ivslot, int forset,
+                      Udata **owner) {
+    LuaObjUData *obj = forset ? ObjIC_receiver(L, o, TM_NEWINDEX, ObjudataMT__newindex)
+                              : ObjIC_receiver(L, o, TM_INDEX, ObjudataMT__index);
+    if (!obj || obj->is_class) return NULL;
+    ObjInlineCache *ic = ObjIC_get(L, ci);
+    if (ic->kind != OBJIC_SLOT || ic->classid != obj->classid) {
+        const TValue *m = ObjIndex_get(obj->vtable, key);
+        if (!ttislightuserdata(m)) return NULL;
+        LuaObjField *field = (LuaObjField *) pvalue(m);
+        LuaObjAccessFlags flags = field->flags;
+        if (!(flags & LUAOBJ_ACCESS_ISFIELD) || flags & LUAOBJ_ACCESS_STATIC) return NULL;
+        if (!(flags & (LUAOBJ_ACCESS_PUBLIC | LUAOBJ_ACCESS_PRIVATE))) return NULL;
+        if (forset && flags & LUAOBJ_ACCESS_CONST) return NULL;
+        if (field->ivslot != (size_t) ivslot) return NULL;
+        LuaObjUData *level = ObjLevel(obj, field->self);
+        if (level == NULL) return NULL;
+        ic->classid = obj->classid;
+        ic->isclass = 0;
+        ic->kind = OBJIC_SLOT;
+        ic->mt = uvalue(o)->metatable;
+        ic->level = field->self;
+        ic->slot = field->slot;
+        ic->levelofs = (int) (level - obj);
+        ic->access = (flags & LUAOBJ_ACCESS_PRIVATE) != 0;
+    }
+    if (ic->access && !Objudata_access(ci, obj)) return NULL;
+    LuaObjUData *level = obj + ic->levelofs;
+    Udata *u = level->outer->udata;
+    if (owner) *owner = u;
+    return &u->uv[OBJLUA_UV_slots + level->slotbase + ivslot].uv;
+}
@@ -26,16 +26,16 @@ enum LuaObjUDataUVIndex {
 };
 
 #define LuaObjUDataUpValueMinSize (OBJLUA_UV_abstractmethods + 1)
+//对象的非static字段值直接放在最外层对象的上值里，从这里开始按LuaObjUData->slotbase+LuaObjField->ivslot排，
+//后面再跟着每个父层视图一个槽（LuaObjUData->viewslot）
+#define OBJLUA_UV_slots LuaObjUDataUpValueMinSize
+//Udata->objlua：类和对象是1，对象父层的视图是2（内存里只有一个指向对象块里那一层LuaObjUData的指针）
+#define OBJLUA_UDATA 1
+#define OBJLUA_VIEW 2
+#define Objudata_get(u) ((u)->objlua == OBJLUA_VIEW ? *(LuaObjUData **) getudatamem(u) : (LuaObjUData *) getudatamem(u))
 #define LuaObjFieldUpValueMinSize (OBJLUA_UV_fields + 1)
 #define LuaObjMethodUpValueMinSize (OBJLUA_UV_gc + 1)
 #define MethodArgTypeUpValueMinSize (OBJLUA_UV_gc + 1)
-/*
-破坏性修改G表结构存储并不友好，
-应该遵循Lua设计风格放置在LUA_REGISTRYINDEX表下，
-其中进行WeekTable化以解决局部类定义的回收问题，
-防止收集了所有面向对象数据后局部表做不到释放。
-*/
-#define OBJLUA_WEAK_TABLE "__ObjLuaWeakTable"
 typedef struct LuaObjUData LuaObjUData;
 
 enum LuaObjAccessFlag {
@@ -49,6 +49,10 @@ enum LuaObjAccessFlag {
     LUAOBJ_ACCESS_NOWRAP = 1 << 7,
     LUAOBJ_ACCESS_ISMETHOD = 1 << 8,
     LUAOBJ_ACCESS_ISFIELD = 1 << 9,
+    LUAOBJ_ACCESS_FINAL = 1 << 10,
+    LUAOBJ_ACCESS_GETTER = 1 << 11,
+    LUAOBJ_ACCESS_SETTER = 1 << 12,
+    LUAOBJ_ACCESS_MEMO = 1 << 13,
 };
 
 typedef size_t LuaObjAccessFlags;
@@ -61,6 +65,8 @@ typedef struct FMStruct {
 typedef struct LuaObjField {
     CommonFMHeader;
     lu_byte initconst;
+    size_t slot; //在声明它的类/对象fields里的下标
+    size_t ivslot; //非static字段在对象上值里的槽位（OBJLUA_UV_slots起）
     //udata自己
     Udata *udata;
 } LuaObjField;
@@ -80,6 +86,8 @@ typedef struct MethodArgType {
         TString *type;
         LuaObjUData *clazz;
     };
+    int typemask; //typemode时定义阶段就把类型名解析好：能匹配的ttype，按(1<<(ttype+1))
+
     //udata自己
     Udata *udata;
 } MethodArgType;
@@ -98,11 +106,33 @@ typedef struct llex_MethodArgTypes {
     llex_MethodArgType *argtypes;
 } llex_MethodArgTypes;
 
+//重载解析缓存：同一组重载按实参签名（个数+每个参数的类型，ObjLua参数再加类编号）记住选中的方法
+#define OBJLUA_OVERLOAD_CACHESIZE 4
+#define OBJLUA_OVERLOAD_MAXARGS 8
+
+//每个类/对象（每一层）@memo方法最多缓存的结果组数
+#define OBJLUA_MEMO_MAX 64
+
+typedef struct OverloadCacheEntry {
+    int argc; //-1为空
+    size_t sig[OBJLUA_OVERLOAD_MAXARGS];
+    struct LuaObjMethod *method;
+} OverloadCacheEntry;
+
+typedef struct OverloadCache {
+    OverloadCacheEntry entries[OBJLUA_OVERLOAD_CACHESIZE];
+    lu_byte next; //满了以后轮换替换的位置
+} OverloadCache;
+
 typedef struct LuaObjMethod {
     CommonFMHeader;
     LClosure *func; //很显然只能是Lua
     MethodArgType **argtypes;
     lu_byte nargs;
+    //同一个类同一组里下一个同名方法（重载链，按定义顺序）
+    struct LuaObjMethod *overload;
+    //只有重载链表头才有：这组有重载或者类型限制时的解析缓存，没有为NULL
+    OverloadCache *ocache;
     //udata自己
     Udata *udata;
 } LuaObjMethod;
@@ -112,41 +142,123 @@ struct LuaObjUData {
     LuaObjUData *super; //如果是类，则指向父类，如果是对象实例，则指向父对象，顶级类/对象时为NULL
     LuaObjUData *classholder; //如果是类，则指向自己，如果是对象实例，则指向类
     lu_byte is_class; //是否是类
+    lu_byte is_final; //@final类（类体结束时定下），不能再被继承，对象同它的类
+    //@memo方法的结果缓存（方法->按参数一层层往下的前缀树，节点[节点]是结果）挂在最外层的GC表里，键是这一层自己，懒创建
+    lu_byte nmemo; //缓存了几组结果，到OBJLUA_MEMO_MAX就整个重建
     //构造函数
     size_t size_constructors;
     LuaObjMethod **constructors;
     //元方法
     size_t size_metamethods;
     LuaObjMethod **metamethods;
-    //字段
+    //字段（对象和类共用同一组LuaObjField，对象的非static字段值在自己的槽里）
     size_t size_fields;
     LuaObjField **fields;
+    size_t nslots; //非static字段数，也就是对象的槽数
+    lu_byte *constinit; //对象的const字段是否已经赋过值，按ivslot，和LuaObjUData在同一块内存里，类为NULL
     //方法
     size_t size_methods;
     LuaObjMethod **methods;
     //抽象方法（要求继承的类必须完成的方法）
     size_t size_abstractmethods;
     LuaObjMethod **abstractmethods;
-    //udata自己
+    //成员索引（由类定义时建立，对象直接共享类的）
+    Table *fieldindex; //名字->fields下标
+    Table *methodindex; //名字->同名方法重载链表头
+    Table *metaindex; //名字->同名元方法重载链表头
+    //扁平化成员表（类体结束时建立）：名字->最近一层可见的字段或方法重载链表头，含继承来的，NULL说明类还没定义完
+    Table *vtable;
+    //带初始值的动态字段合成的初始化函数（类体结束时登记），每次创建对象以那一层为self执行一次，没有为NULL，对象同它的类
+    LClosure *fieldinit;
+    //绑定方法缓存：名字->已绑定到本类/对象的代理函数，按是否类内访问分开（可见的方法可能落在不同层），懒创建
+    Table *boundcache[2];
+    //类编号（global_State里递增分配，不复用），对象同它的类，VM内联缓存靠它判断接收者的类
+    size_t classid;
+    //继承深度（顶级类为0）和祖先表：display[d]是深度d的祖先类，display[depth]就是classholder，对象同它的类
+    int depth;
+    unsigned int memoepoch; //类：objlua.clearMemo(类)的次数，对象不用
+    LuaObjUData **display;
+    //构造函数有重载或者类型限制时的解析缓存（对象用classholder的）
+    OverloadCache *ctorcache;
+    //对象池（objlua.pool开启后类才有）：被回收或者释放的对象留在这里，下次new直接复用，没开启为NULL
+    Table *pool;
+    size_t npooled; //池里现有的对象数
+    size_t poolmax; //池的容量
+    lu_byte inpool; //对象现在是不是在池里
+    //对象的所有层（自己和每一层父对象）放在同一块内存里，outer是最外层（最派生的）那个，类就是自己
+    LuaObjUData *outer;
+    size_t slotbase; //这一层的字段槽在outer上值里的起点（相对OBJLUA_UV_slots），类为0
+    int viewslot; //父层视图挂在outer的哪个上值里，最外层和类为-1
+    unsigned int memogen; //@memo缓存建立时各祖先类memoepoch之和，对不上（objlua.clearMemo过这些类）就作废重建
+    //udata自己，对象父层的视图用到时才创建（Objudata_udata），之前为NULL
     Udata *udata;
 };
 
-LUAI_FUNC int Objudata_init(lua_State *L);
-
-LUAI_FUNC CClosure *RunAtPrepare(lua_State *L, const int nupvals, const lua_CFunction f);
+LUAI_FUNC void RunAtCall(lua_State *L, lua_CFunction f, const TValue *args, int nargs, int nresults);
 
 LUAI_FUNC int RunAtOP_DEFCLASS(lua_State *L);
 
+LUAI_FUNC LuaObjMethod *Objudata_overloads(LuaObjUData *clazz, int meta, TString *name);
+
 LUAI_FUNC int RunAtOP_DEFFIELD(lua_State *L);
 
 LUAI_FUNC int RunAtOP_DEFMETHODARGTYPE(lua_State *L);
 
 LUAI_FUNC int RunAtOP_DEFMETHOD(lua_State *L);
 
+LUAI_FUNC int RunAtOP_CKCABSTRACT(lua_State *L);
+
 LUAI_FUNC int Objudata_MethodWrapCall(lua_State *L);
 
+LUAI_FUNC int ObjudataMT__abstractcall(lua_State *L);
+
+LUAI_FUNC StkId Objudata_bind(lua_State *L, StkId func, int nresults);
+
+LUAI_FUNC LuaObjAccessFlags Objudata_trivial(const Proto *p);
+
+LUAI_FUNC void Objudata_clearmemo(lua_State *L, LuaObjUData *classOrObj);
+
+LUAI_FUNC CallInfo *Objudata_precall(lua_State *L, StkId func, int nresults);
+
+LUAI_FUNC LuaObjUData *Objudata_ciself(CallInfo *ci);
+
+LUAI_FUNC LuaObjUData *Objudata_methodinit(CallInfo *ci);
+
+//是不是类内访问：ci是替origin同一个类工作的方法帧（Objudata_methodinit），只看帧上的标记
+#define Objudata_access(ci, origin) (((ci)->callstatus & CIST_OBJMETHOD) && \
+    Objudata_get((ci)->u.l.objself)->classholder == (origin)->classholder)
+
+LUAI_FUNC Udata *Objudata_udata(lua_State *L, LuaObjUData *classOrObj);
+
+LUAI_FUNC TValue *Objudata_fieldvalue(LuaObjUData *classOrObj, LuaObjField *field, Udata **owner);
+
+LUAI_FUNC void Objudata_setpool(lua_State *L, LuaObjUData *clazz, size_t max);
+
+LUAI_FUNC int Objudata_release(lua_State *L, LuaObjUData *obj);
+
+//ObjInlineCache->kind
+enum ObjInlineCacheKind {
+    OBJIC_FIELD = 1,
+    OBJIC_METHOD,
+    OBJIC_SLOT, //OP_GETSLOT/OP_SETSLOT，lvm.c里直接判命中
+};
+
+LUAI_FUNC int Objudata_icget(lua_State *L, CallInfo *ci, const TValue *o, TString *key, StkId ra);
+
+LUAI_FUNC int Objudata_icset(lua_State *L, CallInfo *ci, const TValue *o, TString *key, const TValue *val);
+
+LUAI_FUNC TValue *Objudata_slot(lua_State *L, CallInfo *ci, const TValue *o, TString *key, int ivslot, int forset,
+                                Udata **owner);
+
+//方法包装层：Lua方法的上一层调用帧，上值1就是self（Objudata_metaProxy的self在它的栈底，单独处理）
+#define Objudata_isMethodWrap(cl) ((cl)->nupvalues >= 2 && \
+    ((cl)->f == Objudata_MethodWrapCall || (cl)->f == ObjudataMT__abstractcall))
+
 LUAI_FUNC int Objudata_metaProxy(lua_State *L);
 
+//方法/元方法代理：luaD_precall/luaD_pretailcall直接换成方法的Lua帧（Objudata_bind）
+#define Objudata_isproxy(f) ((f) == ObjudataMT__abstractcall || (f) == Objudata_metaProxy)
+
 LUAI_FUNC int Objudata_DefConstructor(lua_State *L);
 
 LUAI_FUNC int Objudata_DefMetaMethod(lua_State *L);
@@ -202,6 +314,9 @@ LUA_API int objlua_isAbstract(lua_State *L);
 LUA_API int objlua_isConstructor(lua_State *L);
 
 LUA_API int objlua_isNoWrap(lua_State *L);
+LUA_API int objlua_isFinal(lua_State *L);
+LUA_API int objlua_isMemo(lua_State *L);
+LUA_API int objlua_clearMemo(lua_State *L);
 
 LUA_API int objlua_isMethod(lua_State *L);
 
@@ -229,4 +344,8 @@ LUA_API int objlua_hasMethod(lua_State *L);
 
 LUA_API int objlua_hasField(lua_State *L);
 
+LUA_API int objlua_pool(lua_State *L);
+
+LUA_API int objlua_release(lua_State *L);
+
 #endif
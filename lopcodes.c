@@ -109,4 +109,7 @@ LUAI_DDEF const lu_byte luaP_opmodes[NUM_OPCODES] = {
         , opmode(0, 0, 0, 0, 1, iABC)            /* OP_CKCABSTRACT */
         , opmode(0, 0, 0, 1, 0, iABC)        /* OP_TYPEOF */
         , opmode(0, 0, 0, 1, 0, iABC)        /* OP_INSTANCEOF */
+        , opmode(0, 0, 0, 0, 1, iABC)        /* OP_GETSLOT */
+        , opmode(0, 0, 0, 0, 0, iABC)        /* OP_SETSLOT */
+        , opmode(0, 0, 0, 1, 0, iABC)        /* OP_TESTTYPE */
 };
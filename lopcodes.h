@@ -329,13 +329,22 @@ typedef enum {
                           work on RA+1
                           */
     OP_CKMCONST, /*  A B class:R(A) method:R(B) is good? ChecKMethodCONST */
-    OP_CKCABSTRACT,/*  A clss:R(A) is implement abstract method?  */
+    OP_CKCABSTRACT,/*  A B k clss:R(A) is implement abstract method? then build flattened member table (class body end)
+                          k ? R(B) = fused dynamic field initializer
+                          C ? class is @final
+                          work on RA+1 */
     OP_TYPEOF, /* A B C R(A) = type(R(B)) == R(C), 支持常规Lua类型，类不支持super，相当于支持类的A=type(B)=C*/
     OP_INSTANCEOF, /* A B C R(A) = R(B) instanceof R(C), 不支持常规Lua类型，类支持super，针对面向对象特化的type*/
+    OP_GETSLOT, /*	A B C	R[A] := R[B][K[C]:shortstring]
+                          方法里的self.字段，字段槽位 AT OP_EXTRAARG，接收者对不上时同OP_GETFIELD */
+    OP_SETSLOT, /*	A B C	R[A][K[B]:shortstring] := RK(C)
+                          方法里的self.字段，字段槽位 AT OP_EXTRAARG，接收者对不上时同OP_SETFIELD */
+    OP_TESTTYPE, /*	A B k	if ((type(R[A]) == B) ~= k) then pc++
+                          右边是字面量类型名的typeof，B是类型标签（userdata也认轻量userdata，LUA_NUMTYPES什么都不是） */
 } OpCode;
 
 //#define NUM_OPCODES    ((int)(OP_EXTRAARG) + 1)
-#define NUM_OPCODES    ((int)(OP_INSTANCEOF) + 1)
+#define NUM_OPCODES    ((int)(OP_TESTTYPE) + 1)
 
 
 /*===========================================================================
@@ -105,6 +105,9 @@ static const char *const opnames[] = {
         "CKCABSTRACT",
         "TYPEOF",
         "INSTANCEOF",
+        "GETSLOT",
+        "SETSLOT",
+        "TESTTYPE",
         NULL
 };
 
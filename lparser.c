@@ -750,6 +750,7 @@ static void open_func(LexState *ls, FuncState *fs, BlockCnt *bl) {
     fs->ndebugvars = 0;
     fs->nactvar = 0;
     fs->needclose = 0;
+    fs->selffields = NULL;
     fs->firstlocal = ls->dyd->actvar.n;
     fs->firstlabel = ls->dyd->label.n;
     fs->bl = NULL;
@@ -819,14 +820,30 @@ static void statlist(LexState *ls) {
 }
 
 
+/*
+ * 方法（以及合成的字段初始化函数）里的self.name，name是这个类之前已经定义的对象字段时，
+ * 直接按槽位访问（OP_GETSLOT/OP_SETSLOT），运行时接收者对不上再退回普通的索引
+ */
+static void selfslot(FuncState *fs, expdesc *v, TString *name) {
+    if (v->k != VINDEXSTR) return;
+    const TValue *o = luaH_getshortstr(fs->selffields, name);
+    if (!ttisinteger(o)) return;
+    v->k = VINDEXSLOT;
+    v->u.ind.slot = cast_int(ivalue(o));
+}
+
 static void fieldsel(LexState *ls, expdesc *v) {
     /* fieldsel -> ['.' | ':'] NAME */
     FuncState *fs = ls->fs;
     expdesc key;
+    //self是方法的第一个局部变量
+    int isself = fs->selffields != NULL && v->k == VLOCAL && v->u.var.vidx == 0;
     luaK_exp2anyregup(fs, v);
     luaX_next(ls); /* skip the dot or colon */
     codename(ls, &key);
+    TString *name = key.u.strval;
     luaK_indexed(fs, v, &key);
+    if (isself) selfslot(fs, v, name);
 }
 
 
@@ -1930,8 +1947,9 @@ static void retstat(LexState *ls, int checksemicolon) {
 }
 
 //只支持255-个参数
-static void method_parlist(LexState *ls, llex_MethodArgTypes *argtypes) {
+static void method_parlist(LexState *ls, llex_MethodArgTypes *argtypes, int declare) {
     /* method_parlist -> [ {NAME[:type|<class>] ','} (NAME[:type|<class>] | '...') ] */
+    //declare为0（抽象方法没有函数体）时只收集参数类型，不能把参数声明到外层函数里
     FuncState *fs = ls->fs;
     Proto *f = fs->f;
     int nparams = 0;
@@ -1945,7 +1963,8 @@ static void method_parlist(LexState *ls, llex_MethodArgTypes *argtypes) {
                                                llex_MethodArgType);
                     llex_MethodArgType *argtype = &argtypes->argtypes[argtypes->nargs++];
                     memset(argtype, 0, sizeof(llex_MethodArgType));
-                    new_localvar(ls, str_checkname(ls));
+                    TString *parname = str_checkname(ls);
+                    if (declare) new_localvar(ls, parname);
                     nparams++;
                     if (testnext(ls, ':')) {
                         if (testnext(ls, '<')) {
@@ -1985,6 +2004,7 @@ static void method_parlist(LexState *ls, llex_MethodArgTypes *argtypes) {
             }
         } while (!isvararg && testnext(ls, ','));
     }
+    if (!declare) return;
     adjustlocalvars(ls, nparams);
     f->numparams = cast_byte(fs->nactvar);
     if (isvararg)
@@ -1992,14 +2012,15 @@ static void method_parlist(LexState *ls, llex_MethodArgTypes *argtypes) {
     luaK_reserveregs(fs, fs->nactvar); /* reserve registers for parameters */
 }
 
-static void methodbody(LexState *ls, FuncState *new_fs, expdesc *e, llex_MethodArgTypes *argtypes, int isabstract) {
+static void methodbody(LexState *ls, FuncState *new_fs, expdesc *e, llex_MethodArgTypes *argtypes, int isabstract,
+                       Table *selffields) {
     /*
      * body ->  '(' method_parlist ')' block END
      *     (isabstract) ->  '(' method_parlist ')' END
      */
     if (isabstract) {
         checknext(ls, '(');
-        method_parlist(ls, argtypes);
+        method_parlist(ls, argtypes, 0);
         checknext(ls, ')');
         init_exp(e, VNIL, 0);
     } else {
@@ -2007,11 +2028,12 @@ static void methodbody(LexState *ls, FuncState *new_fs, expdesc *e, llex_MethodA
         new_fs->f = addprototype(ls);
         new_fs->f->linedefined = ls->linenumber;
         open_func(ls, new_fs, &bl);
+        new_fs->selffields = selffields;
         checknext(ls, '(');
         new_localvarliteral(ls, "self");
         new_localvarliteral(ls, "super");
         adjustlocalvars(ls, 2);
-        method_parlist(ls, argtypes);
+        method_parlist(ls, argtypes, 1);
         checknext(ls, ')');
         expdesc selfO, superO;
         searchvar(new_fs, luaS_newliteral(ls->L, "self"), &selfO);
@@ -2039,7 +2061,26 @@ static TString *str_checknameorstring(LexState *ls) {
     return ts;
 }
 
-static void classstat(LexState *ls, int islocal) {
+//合成初始化函数只有self、super两个局部变量，切回外层时把它们从actvar摘下来，切回来再接到栈顶，
+//这样中间解析的方法/静态字段用的actvar和它不会交错，close_func时按栈顶弹出也不会弹错
+static void initfs_suspend(LexState *ls, FuncState *init_fs, Vardesc *saved) {
+    Dyndata *dyd = ls->dyd;
+    lua_assert(init_fs->nactvar == 2 && dyd->actvar.n == init_fs->firstlocal + 2);
+    for (int i = 0; i < 2; ++i) saved[i] = dyd->actvar.arr[init_fs->firstlocal + i];
+    dyd->actvar.n = init_fs->firstlocal;
+    ls->fs = init_fs->prev;
+}
+
+static void initfs_resume(LexState *ls, FuncState *init_fs, const Vardesc *saved) {
+    Dyndata *dyd = ls->dyd;
+    luaM_growvector(ls->L, dyd->actvar.arr, dyd->actvar.n + 2, dyd->actvar.size, Vardesc, SHRT_MAX,
+                    "local variables");
+    init_fs->firstlocal = dyd->actvar.n;
+    for (int i = 0; i < 2; ++i) dyd->actvar.arr[dyd->actvar.n++] = saved[i];
+    ls->fs = init_fs;
+}
+
+static void classstat(LexState *ls, int islocal, int isfinal) {
     FuncState *fs = ls->fs;
     expdesc classdef;
     expdesc classname;
@@ -2074,9 +2115,22 @@ static void classstat(LexState *ls, int islocal) {
     }
     checknext(ls, '{');
     init_exp(&classdef, VNONRELOC, class_reg); //这个阶段class_reg一直是类的寄存器
+    //带初始值的动态字段合成一个初始化函数(self, super)，遇到第一个时打开，类体结束再收尾，
+    //中间穿插的方法/静态字段照常在外层函数里解析（init_fs的局部变量先摘下），轮到下一个动态字段再切回来
+    FuncState init_fs = {0};
+    BlockCnt init_bl;
+    Vardesc init_vars[2]; //切到外层期间暂存self、super
+    int init_proto = -1;
+    //已经定义的对象字段 名字->槽位（和运行时DEFFIELD分配ivslot的顺序一致），方法里的self.字段按槽位访问，挂在栈上防止被回收
+    Table *selffields = luaH_new(ls->L);
+    sethvalue2s(ls->L, ls->L->top.p, selffields);
+    luaD_inctop(ls->L);
+    int nslots = 0;
     while (ls->t.token != '}') {
+        int memberreg = fs->freereg; //每个成员定义完寄存器就用完了，不释放的话成员一多寄存器就不够
         LuaObjAccessFlags flags = 0;
-        int isconst = 0, isstatic = 0, ispublic = 0, isprivate = 0, ismeta = 0, isabstract = 0, isnowrap = 0;
+        int isconst = 0, isstatic = 0, ispublic = 0, isprivate = 0, ismeta = 0, isabstract = 0, isnowrap = 0,
+            isfinal = 0, ismemo = 0;
         int loop_flags = 1;
         while (loop_flags) {
             switch (ls->t.token) {
@@ -2116,6 +2170,14 @@ static void classstat(LexState *ls, int islocal) {
                         if (isnowrap) luaX_syntaxerror(ls, "duplicate nowrap.");
                         isnowrap = 1;
                         break;
+                    } else if (eqstr(annotate, luaS_newliteral(ls->L, "final"))) {
+                        if (isfinal) luaX_syntaxerror(ls, "duplicate final.");
+                        isfinal = 1;
+                        break;
+                    } else if (eqstr(annotate, luaS_newliteral(ls->L, "memo"))) {
+                        if (ismemo) luaX_syntaxerror(ls, "duplicate memo.");
+                        ismemo = 1;
+                        break;
                     } else {
                         luaX_syntaxerror(ls, luaO_pushfstring(ls->L, "illegal annotate: %s", getstr(annotate)));
                     }
@@ -2134,6 +2196,14 @@ static void classstat(LexState *ls, int islocal) {
         if (isprivate) flags |= LUAOBJ_ACCESS_PRIVATE;
         if (ismeta) flags |= LUAOBJ_ACCESS_META;
         if (isabstract) flags |= LUAOBJ_ACCESS_ABSTRACT;
+        if (isfinal) {
+            if (isabstract) luaX_syntaxerror(ls, "abstract or final cannot be used together.");
+            flags |= LUAOBJ_ACCESS_FINAL;
+        }
+        if (ismemo) {
+            if (isabstract || ismeta) luaX_syntaxerror(ls, "memo cannot be used with abstract or meta.");
+            flags |= LUAOBJ_ACCESS_MEMO;
+        }
         TString *name = str_checknameorstring(ls);
         expdesc fielmeth, value;
         if (ls->t.token == '(') {
@@ -2141,6 +2211,7 @@ static void classstat(LexState *ls, int islocal) {
             //Method
             int isconstructor = eqstr(classnamestr, name);
             if (isconstructor) {
+                if (ismemo) luaX_syntaxerror(ls, "memo cannot be used with constructor.");
                 flags &= ~LUAOBJ_ACCESS_STATIC; //构建函数无视static
                 flags |= LUAOBJ_ACCESS_CONSTRUCTOR;
             }
@@ -2150,7 +2221,9 @@ static void classstat(LexState *ls, int islocal) {
             }
             FuncState new_fs = {0};
             llex_MethodArgTypes argtypes = {0}; //这里会额外分配数组，如果存在内容就要清理释放
-            methodbody(ls, &new_fs, &value, &argtypes, isabstract);
+            methodbody(ls, &new_fs, &value, &argtypes, isabstract, selffields);
+            //方法体只是读写一个self.字段的，调用时可以直接按槽位读写不压帧
+            if (!isabstract && !ismeta && !isconstructor) flags |= Objudata_trivial(new_fs.f);
             codestring(&fielmeth, name);
             luaK_exp2nextreg(fs, &fielmeth);
             luaK_codeABC(fs, OP_DEFMETHOD, classdef.u.info, fielmeth.u.info, value.u.info);
@@ -2209,6 +2282,14 @@ static void classstat(LexState *ls, int islocal) {
         } else {
             flags |= LUAOBJ_ACCESS_ISFIELD;
             //Field
+            if (isfinal || ismemo) luaX_syntaxerror(ls, "final or memo is only for methods.");
+            if (!isstatic) {
+                TValue k, slot;
+                setsvalue(ls->L, &k, name);
+                setivalue(&slot, nslots++);
+                luaH_set(ls->L, selffields, &k, &slot);
+                luaC_barrierback(ls->L, obj2gco(selffields), &k);
+            }
             if (testnext(ls, '=')) {
                 //允许定义时直接赋值
                 if (isstatic) {
@@ -2219,27 +2300,37 @@ static void classstat(LexState *ls, int islocal) {
                         flags |= LUAOBJ_ACCESS_NOWRAP;
                         goto nowrapfield;
                     } else {
-                        //动态字段支持赋值的代价很大，需要包装为闭包，每次创建对象才能调用并初始化
-                        //我不能笃定收到一个常量值后面就一定没有运算符，所以动态字段哪怕定义个常量也有很大代价，这也是为什么鼓励构造函数内完成而不是定义时
-                        FuncState new_fs = {0}; //想跑起来只能定义闭包了
-                        BlockCnt bl;
-                        new_fs.f = addprototype(ls);
-                        new_fs.f->linedefined = ls->linenumber;
-                        open_func(ls, &new_fs, &bl);
-                        new_localvarliteral(ls, "self");
-                        new_localvarliteral(ls, "super");
-                        adjustlocalvars(ls, 2);
-                        new_fs.f->numparams = cast_byte(new_fs.nactvar);
-                        luaK_reserveregs(&new_fs, new_fs.nactvar);
-                        expdesc selfO, superO;
-                        searchvar(&new_fs, luaS_newliteral(ls->L, "self"), &selfO);
-                        searchvar(&new_fs, luaS_newliteral(ls->L, "super"), &superO);
-                        luaK_codeABC(&new_fs, OP_METHODINIT, selfO.u.var.vidx, superO.u.var.vidx, 0);
-                        //手动配置好当前的两个local变量
-                        retstat(ls, 0);
-                        new_fs.f->lastlinedefined = ls->linenumber;
-                        codeclosure(ls, &value);
-                        close_func(ls);
+                        //动态字段的初始值要每次创建对象都算一遍，编译成合成初始化函数里的一句self.name = expr
+                        if (init_proto < 0) {
+                            init_fs.f = addprototype(ls);
+                            init_proto = fs->np - 1;
+                            init_fs.f->linedefined = ls->linenumber;
+                            open_func(ls, &init_fs, &init_bl);
+                            init_fs.selffields = selffields;
+                            new_localvarliteral(ls, "self");
+                            new_localvarliteral(ls, "super");
+                            adjustlocalvars(ls, 2);
+                            init_fs.f->numparams = cast_byte(init_fs.nactvar);
+                            luaK_reserveregs(&init_fs, init_fs.nactvar);
+                            expdesc selfO, superO;
+                            searchvar(&init_fs, luaS_newliteral(ls->L, "self"), &selfO);
+                            searchvar(&init_fs, luaS_newliteral(ls->L, "super"), &superO);
+                            luaK_codeABC(&init_fs, OP_METHODINIT, selfO.u.var.vidx, superO.u.var.vidx, 0);
+                        } else initfs_resume(ls, &init_fs, init_vars);
+                        expdesc selfO, key;
+                        searchvar(&init_fs, luaS_newliteral(ls->L, "self"), &selfO);
+                        codestring(&key, name);
+                        luaK_indexed(&init_fs, &selfO, &key);
+                        if (!isconst) selfslot(&init_fs, &selfO, name); //const的要经过__newindex标记已赋值
+                        expr(ls, &value);
+                        luaK_storevar(&init_fs, &selfO, &value);
+                        init_fs.freereg = luaY_nvarstack(&init_fs);
+                        initfs_suspend(ls, &init_fs, init_vars);
+                        //字段本身按没有初始值定义
+                        codestring(&fielmeth, name);
+                        luaK_exp2nextreg(fs, &fielmeth);
+                        luaK_codeABCk(fs, OP_DEFFIELD, classdef.u.info, fielmeth.u.info, 0, 0);
+                        goto field_defined;
                     }
                 }
                 codestring(&fielmeth, name);
@@ -2252,14 +2343,27 @@ static void classstat(LexState *ls, int islocal) {
                 luaK_exp2nextreg(fs, &fielmeth);
                 luaK_codeABCk(fs, OP_DEFFIELD, classdef.u.info, fielmeth.u.info, 0, 0);
             }
+        field_defined:;
             luaK_code(fs, CREATE_Ax(OP_EXTRAARG, flags)); //OP_DEFFIELD+紧跟着的OP_EXTRAARG设置访问
             checknext(ls, ';');
         }
+        fs->freereg = memberreg;
     }
     check_match(ls, '}', '{', classline);
-    if (extends) {
-        luaK_codeABC(fs, OP_CKCABSTRACT, classdef.u.info, 0, 0);
+    expdesc initf;
+    if (init_proto >= 0) {
+        //合成初始化函数收尾，闭包在这里才创建（原型早就登记在外层了，不能用codeclosure取最后一个）
+        initfs_resume(ls, &init_fs, init_vars);
+        init_fs.f->lastlinedefined = ls->linenumber;
+        close_func(ls);
+        init_exp(&initf, VRELOC, luaK_codeABx(fs, OP_CLOSURE, 0, init_proto));
+        luaK_exp2nextreg(fs, &initf);
     }
+    //类体结束：有父类时检查抽象方法，然后都要压平成员表，k为1时R(B)是合成的字段初始化函数，C为1时是@final类
+    luaK_checkstack(fs, 2); //RA+1放压平函数
+    luaK_codeABCk(fs, OP_CKCABSTRACT, classdef.u.info, init_proto >= 0 ? initf.u.info : 0, isfinal,
+                  init_proto >= 0);
+    ls->L->top.p--; //selffields
 }
 
 static void annotateSwitch(LexState *ls) {
@@ -2272,6 +2376,13 @@ static void annotateSwitch(LexState *ls) {
     } else if (eqstr(annotate, luaS_newliteral(ls->L, "class_on"))) {
         ls->objlex = 1;
         luaX_setDefaultObjLex(1);
+    } else if (eqstr(annotate, luaS_newliteral(ls->L, "final"))) {
+        //@final [local] class，不能被继承的类
+        luaX_next(ls);
+        int islocal = testnext(ls, TK_LOCAL);
+        checknext(ls, TK_CLASS);
+        classstat(ls, islocal, 1);
+        return;
     }
     luaX_next(ls);
 }
@@ -2323,7 +2434,7 @@ static void statement(LexState *ls) {
             if (testnext(ls, TK_FUNCTION)) /* local function? */
                 localfunc(ls);
             else if (testnext(ls, TK_CLASS))
-                classstat(ls, 1);
+                classstat(ls, 1, 0);
             else
                 localstat(ls);
             break;
@@ -2353,7 +2464,7 @@ static void statement(LexState *ls) {
         }
         case TK_CLASS: {
             luaX_next(ls);
-            classstat(ls, 0);
+            classstat(ls, 0, 0);
             break;
         }
         case '@': {//注解
@@ -52,6 +52,10 @@ typedef enum {
   VINDEXSTR, /* indexed variable with literal string;
                 ind.t = table register;
                 ind.idx = key's K index */
+  VINDEXSLOT, /* ObjLua: 'self.field' of a declared object field;
+                ind.t = self register;
+                ind.idx = key's K index;
+                ind.slot = field slot in its class */
   VJMP,  /* expression is a test/comparison;
             info = pc of corresponding jump instruction */
   VRELOC,  /* expression can put result in any register;
@@ -61,8 +65,8 @@ typedef enum {
 } expkind;
 
 
-#define vkisvar(k)	(VLOCAL <= (k) && (k) <= VINDEXSTR)
-#define vkisindexed(k)	(VINDEXED <= (k) && (k) <= VINDEXSTR)
+#define vkisvar(k)	(VLOCAL <= (k) && (k) <= VINDEXSLOT)
+#define vkisindexed(k)	(VINDEXED <= (k) && (k) <= VINDEXSLOT)
 
 
 typedef struct expdesc {
@@ -75,6 +79,7 @@ typedef struct expdesc {
     struct {  /* for indexed variables */
       short idx;  /* index (R or "long" K) */
       lu_byte t;  /* table (register or upvalue) */
+      int slot;  /* ObjLua: field slot (VINDEXSLOT) */
     } ind;
     struct {  /* for local variables */
       lu_byte ridx;  /* register holding the variable */
@@ -160,6 +165,8 @@ typedef struct FuncState {
   lu_byte freereg;  /* first free register */
   lu_byte iwthabs;  /* instructions issued since last absolute line info */
   lu_byte needclose;  /* function needs to close upvalues when returning */
+  struct Table *selffields;  /* ObjLua: declared object fields (name -> slot)
+                                of the class this method belongs to */
 } FuncState;
 
 
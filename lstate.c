@@ -26,7 +26,6 @@
 #include "lstring.h"
 #include "ltable.h"
 #include "ltm.h"
-#include "lobjudata.h"
 
 
 
@@ -237,10 +236,10 @@ static void f_luaopen(lua_State* L, void* ud) {
     luaS_init(L);
     luaT_init(L);
     luaX_init(L);
+    luaT_inittypenames(L);
     g->gcstp = 0;  /* allow gc */
     setnilvalue(&g->nilvalue);  /* now state is complete */
     luai_userstateopen(L);
-    Objudata_init(L);//初始化负责记录面向对象的表
 }
 
 
@@ -402,6 +401,7 @@ LUA_API lua_State* lua_newstate(lua_Alloc f, void* ud) {
     g->totalbytes = sizeof(LG);
     g->GCdebt = 0;
     g->lastatomic = 0;
+    g->objclassid = 0;
     setivalue(&g->nilvalue, 0);  /* to signal that state is not yet built */
     setgcparam(g->gcpause, LUAI_GCPAUSE);
     setgcparam(g->gcstepmul, LUAI_GCMUL);
@@ -183,6 +183,7 @@ struct CallInfo {
             const Instruction* savedpc;
             volatile l_signalT trap;  /* function is tracing lines/counts */
             int nextraargs;  /* # of extra arguments in vararg functions */
+            struct Udata *objself;  /* receiver of an ObjLua method frame */
         } l;
         struct {  /* only for C functions */
             lua_KFunction k;  /* continuation in case of yields */
@@ -222,6 +223,7 @@ struct CallInfo {
 #if defined(LUA_COMPAT_LT_LE)
 #define CIST_LEQ	(1<<13)  /* using __lt for __le */
 #endif
+#define CIST_OBJMETHOD	(1<<14)  /* ObjLua method frame ('u.l.objself') */
 
 
 /*
@@ -262,6 +264,7 @@ typedef struct global_State {
     TValue l_registry;
     TValue nilvalue;  /* a nil value */
     unsigned int seed;  /* randomized seed for hashes */
+    size_t objclassid;  /* last ObjLua class id handed out */
     lu_byte currentwhite;
     lu_byte gcstate;  /* state of garbage collector */
     lu_byte gckind;  /* kind of GC running */
@@ -296,6 +299,7 @@ typedef struct global_State {
     struct lua_State* mainthread;
     TString* memerrmsg;  /* message for memory-allocation errors */
     TString* tmname[TM_N];  /* array with tag-method names */
+    TString* tpname[LUA_NUMTYPES];  /* interned basic type names (for 'typeof') */
     struct Table* mt[LUA_NUMTYPES];  /* metatables for basic types */
     TString* strcache[STRCACHE_N][STRCACHE_M];  /* cache for strings in API */
     lua_WarnFunction warnf;  /* warning function */
@@ -265,6 +265,7 @@ Udata *luaS_newudata (lua_State *L, size_t s, int nuvalue) {
   o = luaC_newobj(L, LUA_VUSERDATA, sizeudata(nuvalue, s));
   u = gco2u(o);
   u->len = s;
+  u->objlua = 0;
   u->nuvalue = nuvalue;
   u->metatable = NULL;
   for (i = 0; i < nuvalue; i++)
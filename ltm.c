@@ -53,6 +53,22 @@ void luaT_init (lua_State *L) {
 }
 
 
+/*
+** Intern the basic type names compared by 'typeof'. Must run after
+** 'luaX_init': some names are reserved words (already fixed) and
+** both userdata types share a name, so only new strings are fixed.
+*/
+void luaT_inittypenames (lua_State *L) {
+  int i;
+  for (i=0; i<LUA_NUMTYPES; i++) {
+    TString *ts = luaS_new(L, ttypename(i));
+    if (G(L)->allgc == obj2gco(ts))  /* just created? */
+      luaC_fix(L, obj2gco(ts));  /* never collect these names */
+    G(L)->tpname[i] = ts;
+  }
+}
+
+
 /*
 ** function to be used with macro "fasttm": optimized for absence of
 ** tag methods
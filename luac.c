@@ -380,6 +380,7 @@ static void PrintCode(const Proto *f) {
                 printf("%d %d %d", a, b, c);
                 break;
             case OP_GETFIELD:
+            case OP_GETSLOT:
                 printf("%d %d %d", a, b, c);
                 printf(COMMENT);
                 PrintConstant(f, c);
@@ -409,6 +410,7 @@ static void PrintCode(const Proto *f) {
                 }
                 break;
             case OP_SETFIELD:
+            case OP_SETSLOT:
                 printf("%d %d %d%s", a, b, c, ISK);
                 printf(COMMENT);
                 PrintConstant(f, b);
@@ -713,6 +715,10 @@ static void PrintCode(const Proto *f) {
                 if (flags & LUAOBJ_ACCESS_STATIC) printf("<static> ");
                 if (flags & LUAOBJ_ACCESS_CONST) printf("<const> ");
                 if (flags & LUAOBJ_ACCESS_ABSTRACT) printf("<abstract> ");
+                if (flags & LUAOBJ_ACCESS_FINAL) printf("<final> ");
+                if (flags & LUAOBJ_ACCESS_GETTER) printf("<getter> ");
+                if (flags & LUAOBJ_ACCESS_SETTER) printf("<setter> ");
+                if (flags & LUAOBJ_ACCESS_MEMO) printf("<memo> ");
                 if (flags & LUAOBJ_ACCESS_META) printf("<meta> ");
                 if (flags & LUAOBJ_ACCESS_CONSTRUCTOR) printf("<constructor> ");
                 int nargs = GETARG_Ax(code[pc + 2]);
@@ -725,8 +731,10 @@ static void PrintCode(const Proto *f) {
                 printf(COMMENT "class=R%d method=R%d", a, b);
                 break;
             case OP_CKCABSTRACT:
-                printf("%d", a);
+                printf("%d %d %d%s", a, b, c, ISK);
                 printf(COMMENT "class=R%d", a);
+                if (isk) printf(" fieldinit=R%d", b);
+                if (c) printf(" <final>");
                 break;
             case OP_TYPEOF:
                 printf("%d %d %d", a, b);
@@ -734,6 +742,10 @@ static void PrintCode(const Proto *f) {
             case OP_INSTANCEOF:
                 printf("%d %d", a, b);
                 break;
+            case OP_TESTTYPE:
+                printf("%d %d %d", a, b, isk);
+                printf(COMMENT "%s", b < LUA_NUMTYPES ? ttypename(b) : "?");
+                break;
             default:
                 printf("%d %d %d", a, b, c);
                 printf(COMMENT "not handled");
@@ -872,6 +872,15 @@ void luaV_finishOp(lua_State *L) {
             setobjs2s(L, base + GETARG_A(inst), --L->top.p);
             break;
         }
+        case OP_GETSLOT: {
+            setobjs2s(L, base + GETARG_A(inst), --L->top.p);
+            ci->u.l.savedpc++; /* skip extra argument */
+            break;
+        }
+        case OP_SETSLOT: {
+            ci->u.l.savedpc++; /* skip extra argument */
+            break;
+        }
         case OP_LT:
         case OP_LE:
         case OP_LTI:
@@ -930,60 +939,77 @@ void luaV_finishOp(lua_State *L) {
 }
 
 
-int luaV_typeof(lua_State *L, const TValue *t1, const TValue *t2, TValue *ObjLuaWeakTable) {
-    if (!ObjLuaWeakTable) {
-        if (!luaV_fastget(L, &G(L)->l_registry, luaS_newliteral(L, OBJLUA_WEAK_TABLE), ObjLuaWeakTable,
-                          (TValue *) luaH_getshortstr))
-            luaG_runerror(L, "'f_luaopen' not worked: <"OBJLUA_WEAK_TABLE"> is not initialized");
-    }
-    int typemode = 0;
-    TValue tmp;
-    TValue *slot = &tmp;
-    if (!ttisfulluserdata(t2)) {
-        typemode = 1;
-    } else if (!luaV_fastget(L, ObjLuaWeakTable, t2, slot, luaH_get) && ttistrue(slot)) {
-        typemode = 1;
-    }
-    if (typemode) {
-        setsvalue(L, slot, luaS_new(L, ttypename(ttype(t1))));
-        return luaV_equalobj(L, slot, t2);
+int luaV_typeof(lua_State *L, const TValue *t1, const TValue *t2) {
+    if (!ttisobjlua(t2)) {
+        //类型名都是短字符串，状态创建时就驻留好了，比较指针就行
+        return ttisshrstring(t2) && eqshrstr(tsvalue(t2), G(L)->tpname[ttype(t1)]);
     } else {
-        if (!ttisfulluserdata(t1))return 0;
-        if (!luaV_fastget(L, ObjLuaWeakTable, t1, slot, luaH_get) && ttistrue(slot))return 0;
-        LuaObjUData *o1 = (LuaObjUData *) getudatamem(uvalue(t1));
-        LuaObjUData *o2 = (LuaObjUData *) getudatamem(uvalue(t2));
+        if (!ttisobjlua(t1))return 0;
+        LuaObjUData *o1 = Objudata_get(uvalue(t1));
+        LuaObjUData *o2 = Objudata_get(uvalue(t2));
         return o1->classholder == o2->classholder; //typeof两个对象也是比较他们的类
     }
 }
 
-int luaV_instanceof(lua_State *L, const TValue *t1, const TValue *t2, TValue *ObjLuaWeakTable) {
-    if (!ttisfulluserdata(t1) || !ttisfulluserdata(t2))return 0; //instanceof 要求两边都是userdata类型(然后定位类或者对象)
-    if (!ObjLuaWeakTable) {
-        if (!luaV_fastget(L, &G(L)->l_registry, luaS_newliteral(L, OBJLUA_WEAK_TABLE), ObjLuaWeakTable,
-                          (TValue *) luaH_getshortstr))
-            luaG_runerror(L, "'f_luaopen' not worked: <"OBJLUA_WEAK_TABLE"> is not initialized");
+//两个方法（nargs相同）每个参数的类型限制是否完全一致
+static int luaV_sameargtypes(const LuaObjMethod *m1, const LuaObjMethod *m2) {
+    for (int l = 0; l < m1->nargs; ++l) {
+        MethodArgType *mtype1 = m1->argtypes[l];
+        MethodArgType *mtype2 = m2->argtypes[l];
+        if (mtype1->none != mtype2->none) return 0;
+        if (mtype1->is_vararg != mtype2->is_vararg) return 0;
+        if (mtype1->is_typemode != mtype2->is_typemode) return 0;
+        if (mtype1->is_classmode != mtype2->is_classmode) return 0;
+        if (mtype1->is_classmode && mtype1->clazz != mtype2->clazz) return 0;
+        else if (mtype1->is_typemode && !luaS_streq(mtype1->type, mtype2->type)) return 0;
     }
-    TValue *slot;
-    if (!luaV_fastget(L, ObjLuaWeakTable, t1, slot, luaH_get) && ttistrue(slot))return 0;
-    if (!luaV_fastget(L, ObjLuaWeakTable, t2, slot, luaH_get) && ttistrue(slot))return 0;
-    LuaObjUData *o1 = (LuaObjUData *) getudatamem(uvalue(t1));
-    LuaObjUData *o2 = (LuaObjUData *) getudatamem(uvalue(t2));
+    return 1;
+}
+
+//method是const的并且和wait_method签名一样（也就是wait_method会覆盖它）
+static int luaV_constclash(const LuaObjMethod *method, const LuaObjMethod *wait_method, LuaObjAccessFlags flag) {
+    if (!(method->flags & flag) || !luaS_streq(method->name, wait_method->name)) return 0;
+    if ((method->nargs == 0 && wait_method->nargs == 0) ||
+        (method->argtypes == NULL && wait_method->argtypes == NULL))
+        return 1; //无定义类型
+    if (method->nargs != wait_method->nargs) return 0;
+    //万一什么时候决定支持argtypes=NULL时定义nargs，这就不能过早提前返回
+    return luaV_sameargtypes(method, wait_method);
+}
+
+/*
+** OP_GETSLOT/OP_SETSLOT命中内联缓存时直接给出self.字段的值所在的槽，
+** 没命中/私有字段不是类内访问返回NULL交给Objudata_slot
+*/
+static TValue *luaV_fastslot(CallInfo *ci, Proto *p, const Instruction *pc, const TValue *o, int ivslot,
+                             Udata **owner) {
+    ObjInlineCache *ic;
+    LuaObjUData *obj;
+    if (!ttisfulluserdata(o) || p->objic == NULL) return NULL;
+    ic = &p->objic[pcRel(pc, p)];
+    if (ic->kind != OBJIC_SLOT || uvalue(o)->metatable != ic->mt) return NULL;
+    obj = Objudata_get(uvalue(o));
+    if (obj->classid != ic->classid || obj->is_class) return NULL;
+    if (ic->access && !Objudata_access(ci, obj)) return NULL;
+    obj += ic->levelofs;
+    *owner = obj->outer->udata;
+    return &(*owner)->uv[OBJLUA_UV_slots + obj->slotbase + ivslot].uv;
+}
+
+int luaV_instanceof(lua_State *L, const TValue *t1, const TValue *t2) {
+    (void) L;
+    //instanceof 要求两边都是ObjLua的类或者对象
+    if (!ttisobjlua(t1) || !ttisobjlua(t2))return 0;
+    LuaObjUData *o1 = Objudata_get(uvalue(t1));
+    LuaObjUData *o2 = Objudata_get(uvalue(t2));
     if (o2->is_class) {
-        //需要匹配的是类
-        o1 = o1->classholder, o2 = o2->classholder;
-        while (o1) {
-            if (o1 == o2)return 1;
-            o1 = o1->super;
-        }
-    } else {
-        //指定对象需要匹配，说明需要判断这个对象是不是这个类的子类
-        if (o1->is_class)return 0;
-        while (o1) {
-            if (o1 == o2)return 1;
-            o1 = o1->super;
-        }
+        //需要匹配的是类：祖先表里同深度的位置就是它
+        LuaObjUData *clazz = o1->classholder;
+        return clazz->depth >= o2->depth && clazz->display[o2->depth] == o2;
     }
-    return 0;
+    //指定对象需要匹配，说明需要判断o2是不是o1自己或者它的父层：父层就在同一块内存里o1之后
+    if (o1->is_class)return 0;
+    return o1->outer == o2->outer && o2 >= o1;
 }
 
 /*
@@ -1253,17 +1279,8 @@ int luaV_instanceof(lua_State *L, const TValue *t1, const TValue *t2, TValue *Ob
 #define vmcase(l)    case l:
 #define vmbreak        break
 
-#define ObjWeakTableInit(L) \
-        const TValue *slot;\
-        if (!ObjLuaWeakTable) {\
-        if (!luaV_fastget(L, &G(L)->l_registry, luaS_newliteral(L, OBJLUA_WEAK_TABLE), ObjLuaWeakTable, (TValue *) luaH_getshortstr)) {\
-        luaG_runerror(L, "'f_luaopen' not worked: <"OBJLUA_WEAK_TABLE"> is not initialized");\
-        }\
-        }
-
 
 void luaV_execute(lua_State *L, CallInfo *ci) {
-    TValue *ObjLuaWeakTable = NULL;
     LClosure *cl;
     TValue *k;
     StkId base;
@@ -1412,8 +1429,12 @@ returning: /* trap already set */
                 TString *key = tsvalue(rc); /* key must be a short string */
                 if (luaV_fastget(L, rb, key, slot, luaH_getshortstr)) {
                     setobj2s(L, ra, slot);
-                } else
-                    Protect(luaV_finishget(L, rb, rc, ra, slot));
+                } else {
+                    savestate(L, ci);
+                    //ObjLua类/对象走内联缓存
+                    if (!(ttisfulluserdata(rb) && Objudata_icget(L, ci, rb, key, ra)))
+                        Protect(luaV_finishget(L, rb, rc, ra, slot));
+                }
                 vmbreak;
             }
         vmcase(OP_SETTABUP) {
@@ -1464,8 +1485,12 @@ returning: /* trap already set */
                 TString *key = tsvalue(rb); /* key must be a short string */
                 if (luaV_fastget(L, s2v(ra), key, slot, luaH_getshortstr)) {
                     luaV_finishfastset(L, s2v(ra), slot, rc);
-                } else
-                    Protect(luaV_finishset(L, s2v(ra), rb, rc, slot));
+                } else {
+                    savestate(L, ci);
+                    //ObjLua类/对象走内联缓存
+                    if (!(ttisfulluserdata(s2v(ra)) && Objudata_icset(L, ci, s2v(ra), key, rc)))
+                        Protect(luaV_finishset(L, s2v(ra), rb, rc, slot));
+                }
                 vmbreak;
             }
         vmcase(OP_NEWTABLE) {
@@ -1496,8 +1521,12 @@ returning: /* trap already set */
                 setobj2s(L, ra + 1, rb);
                 if (luaV_fastget(L, rb, key, slot, luaH_getstr)) {
                     setobj2s(L, ra, slot);
-                } else
-                    Protect(luaV_finishget(L, rb, rc, ra, slot));
+                } else {
+                    savestate(L, ci);
+                    //ObjLua类/对象走内联缓存
+                    if (!(ttisfulluserdata(rb) && Objudata_icget(L, ci, rb, key, ra)))
+                        Protect(luaV_finishget(L, rb, rc, ra, slot));
+                }
                 vmbreak;
             }
         vmcase(OP_ADDI) {
@@ -2015,16 +2044,14 @@ returning: /* trap already set */
                 StkId rb = RB(i);
                 StkId rc = RC(i);
                 const int extendsmode = GETARG_k(i);
-                CClosure *execCL = RunAtPrepare(L, 2, RunAtOP_DEFCLASS);
-                setobj2n(L, &execCL->upvalue[0], s2v(rb)); //类名
+                TValue args[2];
+                setobj(L, &args[0], s2v(rb)); //类名
                 if (extendsmode) {
-                    setobj2n(L, &execCL->upvalue[1], s2v(rc)); //扩展模式
-                }
-                setclCvalue(L, s2v(ra), execCL);
-                //OP_CALL
-                L->top.p = ra + 1;
+                    setobj(L, &args[1], s2v(rc)); //扩展模式
+                } else
+                    setnilvalue(&args[1]);
                 savepc(L);
-                luaD_precall(L, ra, 1);
+                RunAtCall(L, RunAtOP_DEFCLASS, args, 2, 1);
                 updatebase(ci);
                 ra = RA(i);
                 //拷贝走返回值
@@ -2037,26 +2064,24 @@ returning: /* trap already set */
                 StkId ra = RA(i);
                 StkId rb = RB(i);
                 StkId rc = RC(i);
+                const Instruction instruction = i;
                 int withInit = GETARG_k(i);
                 i = *(pc++);
                 lua_assert(GET_OPCODE(i) == OP_EXTRAARG); //因为flags没地方设置了，所以干脆跟一个OP_EXTRAARG存进去就完事了
                 LuaObjAccessFlags flags = (LuaObjAccessFlags) GETARG_Ax(i);
-                CClosure *execCL = RunAtPrepare(L, 5, RunAtOP_DEFFIELD);
-                setobj2n(L, &execCL->upvalue[0], s2v(ra)); //类
-                setobj2n(L, &execCL->upvalue[1], s2v(rb)); //字段名
-                setobj2n(L, &execCL->upvalue[2], s2v(rc)); //字段值
-                setivalue(&execCL->upvalue[3], flags); //字段访问标志
+                TValue args[5];
+                setobj(L, &args[0], s2v(ra)); //类
+                setobj(L, &args[1], s2v(rb)); //字段名
+                setobj(L, &args[2], s2v(rc)); //字段值
+                setivalue(&args[3], flags); //字段访问标志
                 if (withInit)
-                    setbtvalue(&execCL->upvalue[4]);
+                    setbtvalue(&args[4]);
                 else
-                    setbfvalue(&execCL->upvalue[4]);
-                setclCvalue(L, s2v(ra+1), execCL);
-                //OP_CALL
-                L->top.p = ra + 2;
+                    setbfvalue(&args[4]);
                 savepc(L);
-                luaD_precall(L, ra + 1, 0);
+                RunAtCall(L, RunAtOP_DEFFIELD, args, 5, 0);
                 updatebase(ci);
-                luaC_barrier(L, obj2gco(s2v(ra)), s2v(ra));
+                ra = RA(instruction);
                 checkGC(L, ra + 2);
                 vmbreak;
             }
@@ -2064,22 +2089,14 @@ returning: /* trap already set */
                 //ra=self,rb=super
                 StkId ra = RA(i);
                 StkId rb = RB(i);
-                //当前肯定是LUA_VLCL，上一个应该是Objudata_MethodWrapCall的LUA_VCCL，先检查，如果不是就别做任何操作了
-                CallInfo *lastCall = ci->previous;
-                if (lastCall && ttypetag(s2v(lastCall->func.p)) == LUA_VCCL) {
-                    CClosure *wrapcall = clCvalue(s2v(lastCall->func.p));
-                    if ((Objudata_MethodWrapCall == wrapcall->f ||
-                         Objudata_metaProxy == wrapcall->f)
-                        && wrapcall->nupvalues >= 2) {
-                        //现在确定了是给谁工作的，上值第一个就是类/对象，也就是self，super只需要再往里找就能找到
-                        TValue *selfTV = &wrapcall->upvalue[0];
-                        setobj2s(L, ra, selfTV);
-                        LuaObjUData *classobj = (LuaObjUData *) getudatamem(uvalue(selfTV));
-                        if (classobj->super) {
-                            setuvalue(L, s2v(rb), classobj->super->udata);
-                        } else
-                            setnilvalue(s2v(rb));
-                    }
+                //当前肯定是LUA_VLCL，直接压栈的方法帧或者上一个是方法包装层才知道给谁工作，不是就别做任何操作了
+                LuaObjUData *classobj = Objudata_methodinit(ci);
+                if (classobj) {
+                    setuvalue(L, s2v(ra), classobj->udata);
+                    if (classobj->super) {
+                        setuvalue(L, s2v(rb), Objudata_udata(L, classobj->super));
+                    } else
+                        setnilvalue(s2v(rb));
                 }
                 vmbreak;
             }
@@ -2087,20 +2104,19 @@ returning: /* trap already set */
                 StkId ra = RA(i);
                 StkId rb = RB(i);
                 int typeflags = GETARG_C(i);
+                const Instruction instruction = i;
                 i = *(pc++);
                 lua_assert(GET_OPCODE(i) == OP_EXTRAARG); //因为arg_pos没地方设置了，所以干脆跟一个OP_EXTRAARG存进去就完事了
                 int arg_pos = GETARG_Ax(i);
-                CClosure *execCL = RunAtPrepare(L, 4, RunAtOP_DEFMETHODARGTYPE);
-                setobj2n(L, &execCL->upvalue[0], s2v(ra)); //方法
-                setobj2n(L, &execCL->upvalue[1], s2v(rb)); //类型
-                setivalue(&execCL->upvalue[2], typeflags);
-                setivalue(&execCL->upvalue[3], arg_pos);
-                setclCvalue(L, s2v(ra+1), execCL);
-                //OP_CALL
-                L->top.p = ra + 2;
+                TValue args[4];
+                setobj(L, &args[0], s2v(ra)); //方法
+                setobj(L, &args[1], s2v(rb)); //类型
+                setivalue(&args[2], typeflags);
+                setivalue(&args[3], arg_pos);
                 savepc(L);
-                luaD_precall(L, ra + 1, 0);
+                RunAtCall(L, RunAtOP_DEFMETHODARGTYPE, args, 4, 0);
                 updatebase(ci);
+                ra = RA(instruction);
                 checkGC(L, ra + 2);
                 vmbreak;
             }
@@ -2115,108 +2131,71 @@ returning: /* trap already set */
                 i = *(pc++);
                 lua_assert(GET_OPCODE(i) == OP_EXTRAARG); //因为nargs没地方设置了，所以干脆跟一个OP_EXTRAARG存进去就完事了
                 int nargs = GETARG_Ax(i);
-                CClosure *execCL = RunAtPrepare(L, 5, RunAtOP_DEFMETHOD);
-                setobj2n(L, &execCL->upvalue[0], s2v(ra)); //类
-                setobj2n(L, &execCL->upvalue[1], s2v(rb)); //方法名
-                setobj2n(L, &execCL->upvalue[2], s2v(rc)); //方法实现函数
-                setivalue(&execCL->upvalue[3], flags);
-                setivalue(&execCL->upvalue[4], nargs);
-                setclCvalue(L, s2v(ra + 1), execCL);
-                //OP_CALL
-                L->top.p = ra + 2;
+                TValue args[5];
+                setobj(L, &args[0], s2v(ra)); //类
+                setobj(L, &args[1], s2v(rb)); //方法名
+                setobj(L, &args[2], s2v(rc)); //方法实现函数
+                setivalue(&args[3], flags);
+                setivalue(&args[4], nargs);
                 savepc(L);
-                luaD_precall(L, ra + 1, 1);
+                RunAtCall(L, RunAtOP_DEFMETHOD, args, 5, 1);
                 updatebase(ci);
                 ra = RA(instruction);//这可不是i，已经pc++了，查看我一下午BUG啊
                 //拷贝走返回值
-                if (ra + 1 != L->top.p - 1)
-                    setobjs2s(L, ra+1, L->top.p - 1);
-                luaC_barrier(L, obj2gco(s2v(ra+1)), s2v(ra+1));
+                setobjs2s(L, ra + 1, L->top.p - 1);
                 checkGC(L, ra + 2);
                 vmbreak;
             }
         vmcase(OP_CKMCONST) {
-                ObjWeakTableInit(L);
                 //ra=class,rb=method
                 StkId ra = RA(i);
                 StkId rb = RB(i);
                 const int methodgroup = GETARG_C(i);
                 //首先检查ra是不是class
-                if (!(luaV_fastget(L, ObjLuaWeakTable, s2v(ra), slot, luaH_get) && ttistrue(slot)))
-                    luaG_runerror(L, "method constant check failed: not a class in "OBJLUA_WEAK_TABLE);
-                LuaObjUData *clazz = (LuaObjUData *) getudatamem(uvalue(s2v(ra)));
+                if (!ttisobjlua(s2v(ra)))
+                    luaG_runerror(L, "method constant check failed: not a class");
+                LuaObjUData *clazz = Objudata_get(uvalue(s2v(ra)));
                 if (!clazz->is_class) luaG_runerror(L, "method constant check failed: target is object");
                 if (!ttisfulluserdata(s2v(rb)))
                     luaG_runerror(L, "method constant check failed: method must be userdata<LuaObjMethod>");
                 LuaObjMethod *wait_method = (LuaObjMethod *) getudatamem(uvalue(s2v(rb)));
                 LuaObjUData *super = clazz;
-                int showError = 0;
-                while (super && !showError) {
-                    size_t size = 0;
-                    LuaObjMethod **methods = NULL;
+                const LuaObjMethod *clash = NULL;
+                while (super && !clash) {
+                    //@final只管父类里的，自己这一层的同名方法只是重载
+                    LuaObjAccessFlags flag = super == clazz ? LUAOBJ_ACCESS_CONST
+                                                            : LUAOBJ_ACCESS_CONST | LUAOBJ_ACCESS_FINAL;
                     if (methodgroup == OBJLUA_UV_constructors) {
-                        size = super->size_constructors;
-                        methods = super->constructors;
-                    } else if (methodgroup == OBJLUA_UV_metamethods) {
-                        size = super->size_metamethods;
-                        methods = super->metamethods;
-                    } else if (methodgroup == OBJLUA_UV_methods) {
-                        size = super->size_methods;
-                        methods = super->methods;
+                        //构造函数都同名，整组都是候选
+                        for (size_t j = 0; j < super->size_constructors && !clash; ++j)
+                            if (luaV_constclash(super->constructors[j], wait_method, flag))
+                                clash = super->constructors[j];
+                    } else if (methodgroup == OBJLUA_UV_metamethods || methodgroup == OBJLUA_UV_methods) {
+                        //只需要看同名重载链
+                        LuaObjMethod *method = Objudata_overloads(super, methodgroup == OBJLUA_UV_metamethods,
+                                                                  wait_method->name);
+                        for (; method && !clash; method = method->overload)
+                            if (luaV_constclash(method, wait_method, flag)) clash = method;
                     } //抽象方法不是具体实现，不用检查
-                    for (int j = 0; methods && j < size; ++j) {
-                        LuaObjMethod *method = methods[j];
-                        LuaObjAccessFlags flags = method->flags;
-                        if (flags & LUAOBJ_ACCESS_CONST && luaS_streq(method->name, wait_method->name)) {
-                            if ((method->nargs == 0 && wait_method->nargs == 0) ||
-                                (method->argtypes == NULL && wait_method->argtypes == NULL)) {
-                                //无定义类型
-                                showError = 1;
-                                break;
-                            }
-                            if (method->nargs != wait_method->nargs) continue;
-                            //万一什么时候决定支持argtypes=NULL时定义nargs，这就不能过早提前continue
-                            int match_all = 1;
-                            for (int l = 0; l < method->nargs; ++l) {
-                                MethodArgType *mtype1 = method->argtypes[l];
-                                MethodArgType *mtype2 = wait_method->argtypes[l];
-                                if (mtype1->none != mtype2->none) goto CKMCONSTset_match_all_0;
-                                if (mtype1->is_vararg != mtype2->is_vararg) goto CKMCONSTset_match_all_0;
-                                if (mtype1->is_typemode != mtype2->is_typemode) goto CKMCONSTset_match_all_0;
-                                if (mtype1->is_classmode != mtype2->is_classmode) goto CKMCONSTset_match_all_0;
-                                if (mtype1->is_classmode && mtype1->clazz != mtype2->clazz)
-                                    goto CKMCONSTset_match_all_0
-                                            ;
-                                else if (mtype1->is_typemode && !luaS_streq(mtype1->type, mtype2->type))
-                                    goto
-                                            CKMCONSTset_match_all_0;
-                                continue;
-                            CKMCONSTset_match_all_0:;
-                                match_all = 0;
-                                break;
-                            }
-                            if (match_all) {
-                                showError = 1;
-                                break;
-                            }
-                        }
-                    }
                     super = super->super;
                 }
-                if (showError) luaG_runerror(L, "method is const define at super class");
+                if (clash) {
+                    if (clash->flags & LUAOBJ_ACCESS_CONST)
+                        luaG_runerror(L, "method is const define at super class");
+                    luaG_runerror(L, "method '%s' is final at super class", getstr(wait_method->name));
+                }
                 vmbreak;
             }
         vmcase(OP_CKCABSTRACT) {
-                ObjWeakTableInit(L);
                 //ra=class
                 StkId ra = RA(i);
                 //首先检查ra是不是class
-                if (!(luaV_fastget(L, ObjLuaWeakTable, s2v(ra), slot, luaH_get) && ttistrue(slot)))
-                    luaG_runerror(L, "method constant check failed: not a class in "OBJLUA_WEAK_TABLE);
-                LuaObjUData *clazz = (LuaObjUData *) getudatamem(uvalue(s2v(ra)));
+                if (!ttisobjlua(s2v(ra)))
+                    luaG_runerror(L, "method constant check failed: not a class");
+                LuaObjUData *clazz = Objudata_get(uvalue(s2v(ra)));
                 if (!clazz->is_class) luaG_runerror(L, "method constant check failed: target is object");
                 if (clazz->super) {
-                    //很显然只有有super的类才需要校验是否完成抽象方法，虽然编译阶段也会自动省略OP_CKCABSTRACT，但是万一发生了呢对吧
+                    //很显然只有有super的类才需要校验是否完成抽象方法
                     LuaObjUData *super = clazz->super;
                     if (super->size_abstractmethods) {
                         //你最好没定义，定义了还得在这里检查
@@ -2225,23 +2204,28 @@ returning: /* trap already set */
                         for (int j = 0; super->abstractmethods && j < super->size_abstractmethods; ++j) {
                             abstractmethod = super->abstractmethods[j];
                             LuaObjAccessFlags flags = abstractmethod->flags;
+                            //构造函数都同名，整组都是候选；其余的只需要看同名重载链
                             LuaObjMethod **checkmethods = NULL;
                             size_t sizecheckmethods = 0;
+                            LuaObjMethod *c_method = NULL;
                             if (flags & LUAOBJ_ACCESS_CONSTRUCTOR) {
                                 checkmethods = clazz->constructors;
                                 sizecheckmethods = clazz->size_constructors;
-                            } else if (flags & LUAOBJ_ACCESS_META) {
-                                checkmethods = clazz->metamethods;
-                                sizecheckmethods = clazz->size_metamethods;
                             } else {
-                                checkmethods = clazz->methods;
-                                sizecheckmethods = clazz->size_methods;
+                                c_method = Objudata_overloads(clazz, flags & LUAOBJ_ACCESS_META,
+                                                              abstractmethod->name);
                             }
                             int match = 0;
-                            for (int l = 0; checkmethods && l < sizecheckmethods; ++l) {
-                                LuaObjMethod *c_method = checkmethods[l];
-                                LuaObjAccessFlags c_flags = c_method->flags | LUAOBJ_ACCESS_ABSTRACT;
-                                //因为抽象方法自带这个flag得加上
+                            for (size_t l = 0; !match; ++l) {
+                                if (checkmethods) {
+                                    if (l >= sizecheckmethods) break;
+                                    c_method = checkmethods[l];
+                                } else if (l) c_method = c_method->overload;
+                                if (c_method == NULL) break;
+                                LuaObjAccessFlags c_flags = (c_method->flags | LUAOBJ_ACCESS_ABSTRACT) &
+                                                            ~(LUAOBJ_ACCESS_FINAL | LUAOBJ_ACCESS_GETTER |
+                                                              LUAOBJ_ACCESS_SETTER);
+                                //因为抽象方法自带这个flag得加上，实现可以是@final的，平凡存取方法的标记也不算
                                 if (c_flags != flags) continue;
                                 if (c_method->nargs != abstractmethod->nargs) continue;
                                 if (c_method->argtypes == NULL && abstractmethod->argtypes != NULL) continue;
@@ -2249,31 +2233,9 @@ returning: /* trap already set */
                                 //快速检查完之后匹配名字
                                 if (!luaS_streq(c_method->name, abstractmethod->name)) continue;
                                 //最好深入检查argtypes
-                                if (abstractmethod->nargs && abstractmethod->argtypes) {
-                                    int match_all = 1;
-                                    for (int l2 = 0; l2 < abstractmethod->nargs; ++l2) {
-                                        MethodArgType *mtype1 = c_method->argtypes[l2];
-                                        MethodArgType *mtype2 = abstractmethod->argtypes[l2];
-                                        if (mtype1->none != mtype2->none) goto CKCABSTRACTset_match_all_0;
-                                        if (mtype1->is_vararg != mtype2->is_vararg) goto CKCABSTRACTset_match_all_0;
-                                        if (mtype1->is_typemode != mtype2->is_typemode) goto CKCABSTRACTset_match_all_0;
-                                        if (mtype1->is_classmode != mtype2->is_classmode)
-                                            goto
-                                                    CKCABSTRACTset_match_all_0;
-                                        if (mtype1->is_classmode && mtype1->clazz != mtype2->clazz)
-                                            goto
-                                                    CKCABSTRACTset_match_all_0;
-                                        else if (mtype1->is_typemode && !luaS_streq(mtype1->type, mtype2->type))
-                                            goto
-                                                    CKCABSTRACTset_match_all_0;
-                                        continue;
-                                    CKCABSTRACTset_match_all_0:;
-                                        match_all = 0;
-                                        break;
-                                    }
-                                    if (match_all)
-                                        match = 1;
-                                }
+                                if (abstractmethod->nargs && abstractmethod->argtypes &&
+                                    luaV_sameargtypes(c_method, abstractmethod))
+                                    match = 1;
                             }
                             if (!match) {
                                 showError = 1;
@@ -2289,23 +2251,89 @@ returning: /* trap already set */
                         }
                     }
                 }
+                clazz->is_final = GETARG_C(i); //@final类
+                //类体结束，压平成员表，登记合成的字段初始化函数
+                TValue args[2];
+                setobj(L, &args[0], s2v(ra)); //类
+                if (GETARG_k(i)) {
+                    setobj(L, &args[1], s2v(RB(i))); //字段初始化函数
+                } else
+                    setnilvalue(&args[1]);
+                savepc(L);
+                RunAtCall(L, RunAtOP_CKCABSTRACT, args, 2, 0);
+                updatebase(ci);
+                ra = RA(i);
+                checkGC(L, ra + 2);
+                vmbreak;
+            }
+        vmcase(OP_GETSLOT) {
+                StkId ra = RA(i);
+                const TValue *slot;
+                TValue *rb = vRB(i);
+                TValue *rc = KC(i);
+                TString *key = tsvalue(rc); /* key must be a short string */
+                int ivslot = GETARG_Ax(*pc); //OP_EXTRAARG，跳过它要等这条指令完成（元方法里报错/让出时savedpc还停在这）
+                Udata *owner;
+                TValue *v;
+                if ((v = luaV_fastslot(ci, cl->p, pc, rb, ivslot, &owner)) != NULL) {
+                    setobj2s(L, ra, v);
+                } else if (luaV_fastget(L, rb, key, slot, luaH_getshortstr)) {
+                    setobj2s(L, ra, slot);
+                } else {
+                    savestate(L, ci);
+                    if (!(ttisfulluserdata(rb) && (v = Objudata_slot(L, ci, rb, key, ivslot, 0, &owner)) != NULL))
+                        Protect(luaV_finishget(L, rb, rc, ra, slot));
+                    else
+                        setobj2s(L, ra, v);
+                }
+                pc++;
+                vmbreak;
+            }
+        vmcase(OP_SETSLOT) {
+                StkId ra = RA(i);
+                const TValue *slot;
+                TValue *rb = KB(i);
+                TValue *rc = RKC(i);
+                TString *key = tsvalue(rb); /* key must be a short string */
+                int ivslot = GETARG_Ax(*pc); //同OP_GETSLOT
+                Udata *owner;
+                TValue *v;
+                if ((v = luaV_fastslot(ci, cl->p, pc, s2v(ra), ivslot, &owner)) != NULL) {
+                    setobj(L, v, rc);
+                    luaC_barrierback(L, obj2gco(owner), rc);
+                } else if (luaV_fastget(L, s2v(ra), key, slot, luaH_getshortstr)) {
+                    luaV_finishfastset(L, s2v(ra), slot, rc);
+                } else {
+                    savestate(L, ci);
+                    if (ttisfulluserdata(s2v(ra)) && (v = Objudata_slot(L, ci, s2v(ra), key, ivslot, 1, &owner)) != NULL) {
+                        setobj(L, v, rc);
+                        luaC_barrierback(L, obj2gco(owner), rc);
+                    } else
+                        Protect(luaV_finishset(L, s2v(ra), rb, rc, slot));
+                }
+                pc++;
                 vmbreak;
             }
         vmcase(OP_TYPEOF) {
-                ObjWeakTableInit(L);
                 int cond;
                 StkId ra = RA(i);
                 StkId rb = RB(i);
-                Protect(cond = !luaV_typeof(L, s2v(ra), s2v(rb),ObjLuaWeakTable));
+                Protect(cond = !luaV_typeof(L, s2v(ra), s2v(rb)));
+                docondjump();
+                vmbreak;
+            }
+        vmcase(OP_TESTTYPE) {
+                StkId ra = RA(i);
+                int t = ttype(s2v(ra));
+                int cond = t == GETARG_B(i) || (t == LUA_TLIGHTUSERDATA && GETARG_B(i) == LUA_TUSERDATA);
                 docondjump();
                 vmbreak;
             }
         vmcase(OP_INSTANCEOF) {
-                ObjWeakTableInit(L);
                 int cond;
                 StkId ra = RA(i);
                 StkId rb = RB(i);
-                Protect(cond = !luaV_instanceof(L, s2v(ra), s2v(rb),ObjLuaWeakTable));
+                Protect(cond = !luaV_instanceof(L, s2v(ra), s2v(rb)));
                 docondjump();
                 vmbreak;
             }
@@ -116,8 +116,8 @@ typedef enum {
 #define luaV_shiftr(x,y)	luaV_shiftl(x,intop(-, 0, y))
 
 
-LUAI_FUNC int luaV_typeof(lua_State *L, const TValue *t1, const TValue *t2, TValue *ObjLuaWeakTable);
-LUAI_FUNC int luaV_instanceof(lua_State *L, const TValue *t1, const TValue *t2, TValue *ObjLuaWeakTable);
+LUAI_FUNC int luaV_typeof(lua_State *L, const TValue *t1, const TValue *t2);
+LUAI_FUNC int luaV_instanceof(lua_State *L, const TValue *t1, const TValue *t2);
 LUAI_FUNC int luaV_equalobj (lua_State *L, const TValue *t1, const TValue *t2);
 LUAI_FUNC int luaV_lessthan (lua_State *L, const TValue *l, const TValue *r);
 LUAI_FUNC int luaV_lessequal (lua_State *L, const TValue *l, const TValue *r);
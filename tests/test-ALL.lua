@@ -25,6 +25,22 @@ local files = {
     "test-lambda.lua",
     "test-dyn-field.lua",
     "test-hotfix.lua",
+    "test-method-alloc.lua",
+    "test-field-memory.lua",
+    "test-gc-pause.lua",
+    "test-deep-new.lua",
+    "test-pool.lua",
+    "test-big-class.lua",
+    "test-field-init.lua",
+    "test-self-slot.lua",
+    "test-private-access.lua",
+    "test-yield-method.lua",
+    "test-tail-method.lua",
+    "test-meta-dispatch.lua",
+    "test-final.lua",
+    "test-trivial-accessor.lua",
+    "test-memo.lua",
+    "test-overload-cache.lua",
     "test-classonoff.lua",
 }
 for i, file in ipairs(files) do
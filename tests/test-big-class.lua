@@ -0,0 +1,31 @@
+--成员很多的类：定义期间寄存器每个成员用完就释放，成员数组按倍数扩容，定义耗时和成员数成线性
+local function gen(n, super)
+    local t = { super and ("class Big%d:%s{"):format(n, super) or ("class Big%d{"):format(n) }
+    for i = 1, n do
+        t[#t + 1] = ("public f%d = %d;"):format(i, i)
+        t[#t + 1] = ("public m%d(){ return %d }"):format(i, i)
+        t[#t + 1] = ("public o%d(a:number){ return a + %d }"):format(i, i)
+        t[#t + 1] = ("public o%d(a:string){ return a .. %d }"):format(i, i)
+    end
+    t[#t + 1] = "}"
+    t[#t + 1] = ("return Big%d"):format(n)
+    return table.concat(t, "\n")
+end
+local Big = assert(load(gen(1000)))()
+local b = Big()
+assert(b.f1 == 1 and b.f1000 == 1000)
+assert(b.m500() == 500 and b.o7(1) == 8 and b.o7("x") == "x7")
+--子类覆盖（const检查/抽象检查走名字索引）
+class Base{
+    public const k(){ return 1 }
+    @abstract public need(a:number);
+}
+class Impl:Base{
+    public need(a:number){ return a }
+}
+assert(Impl().need(3) == 3 and Impl().k() == 1)
+assert(not pcall(assert(load("class Bad:Base{ public k(){ return 2 } public need(a:number){ return a } }"))),
+    "const method cannot be overridden")
+assert(not pcall(assert(load("class Bad2:Base{ public need(a:string){ return a } }"))),
+    "abstract method with other signature is not an implementation")
+print("test-big-class.lua", "ok")
@@ -0,0 +1,29 @@
+--继承链上的父对象和对象自己在同一块内存里，深的继承链new一个对象的开销应该和没有父类的差不多
+class L0{ public v = 0; public L0(v){ self.v = v } public get(){ return self.v } }
+class L1:L0{}
+class L2:L1{}
+class L3:L2{}
+class L4:L3{ public top(){ return super } }
+local N = 1000
+local function cost(clazz)
+    local objs = {}
+    collectgarbage("collect")
+    collectgarbage("stop")
+    objs[1] = clazz(0)--预热
+    local before = collectgarbage("count")
+    for i = 2, N + 1 do
+        objs[i] = clazz(i)
+    end
+    local after = collectgarbage("count")
+    collectgarbage("restart")
+    return (after - before) * 1024 / N, objs
+end
+local flat = cost(L0)
+local deep, objs = cost(L4)
+print("bytes per instance (depth 0) mem:", flat)
+print("bytes per instance (depth 4) mem:", deep)
+--每多一层父类多出来的应该远小于一个完整对象
+assert((deep - flat) / 4 < flat / 2, "super parts should not cost a full object each")
+local o = objs[N]
+assert(o.get() == N and o instanceof L0 and o.top().get() == N)
+assert(objlua.getSuper(o) == o.top() and objlua.getClass(o.top()) == L3)
@@ -0,0 +1,53 @@
+--带初始值的动态字段合成一个初始化函数：每层每个对象只调用一次，按定义顺序求值，类内访问/const/父层都照常
+local calls = 0
+local up = 10
+class A{
+    private const secret = up + 1;
+    public a = {};
+    public get(){ return self.secret }
+    public b = self.a;
+    static s = 5;
+    @nowrap public nw = {};
+    public c = (function() calls = calls + 1 return self.b end)();
+    public f(){ return 1 }
+}
+class B:A{
+    public d = super.get() + 1;
+    public const e = "e";
+    public B(){ self.x = self.x + 1 }
+    public x = 3;
+}
+local b = B()
+assert(b.get() == 11 and b.d == 12 and b.e == "e" and b.a == b.b and b.c == b.a)
+assert(calls == 1 and b.x == 4)
+assert(not pcall(function() b.e = 1 end))
+assert(not pcall(function() return b.secret end))
+local b2 = B()
+assert(b2.a ~= b.a and b2.nw == b.nw and calls == 2)
+up = 20
+assert(A().get() == 21)
+--顺序：先拷贝@nowrap的值，再按定义顺序跑初始化器
+class O{
+    public a = self.b;
+    @nowrap public b = 5;
+    public c = self.d;
+    public d = 1;
+    public e = self.d;
+}
+local o = O()
+assert(o.a == 5 and o.b == 5 and o.c == nil and o.d == 1 and o.e == 1)
+--初始化器之间穿插带局部变量的方法/静态字段，初始化器里的闭包捕获外层局部变量
+local base = 100
+class I{
+    public x = base + 1;
+    public m(p){ local q = p * 2 local r = q + 1 return r }
+    static st = (function() local t1, t2 = 1, 2 return t1 + t2 end)();
+    public y = (function() local z = self.x return function() return z + base end end)();
+    public n(u, v){ local w = u + v return w }
+    public z = self.m(1) + self.n(2, 3);
+}
+local i = I()
+assert(i.x == 101 and i.y() == 201 and i.z == 8 and I.st == 3)
+base = 0
+assert(I().x == 1 and i.y() == 101)
+print("test-field-init.lua", "ok")
@@ -0,0 +1,33 @@
+--实例字段直接放在对象的槽里，字段多的对象每个实例的内存应该和字段数成正比，而不是每个字段一个独立的userdata
+class Wide{
+    public f1 = 1; public f2 = 2; public f3 = 3; public f4 = 4;
+    public f5 = 5; public f6 = 6; public f7 = 7; public f8 = 8;
+    public f9 = 9; public f10 = 10; public f11 = 11; public f12 = 12;
+    public f13 = 13; public f14 = 14; public f15 = 15; public f16 = 16;
+    public f17 = 17; public f18 = 18; public f19 = 19; public f20 = 20;
+    public f21 = 21; public f22 = 22; public f23 = 23; public f24 = 24;
+    public sum(){
+        return self.f1 + self.f12 + self.f24
+    }
+}
+local N = 1000
+local objs = {}
+collectgarbage("collect")
+collectgarbage("stop")
+objs[1] = Wide()--预热
+local before = collectgarbage("count")
+for i = 2, N + 1 do
+    objs[i] = Wide()
+end
+local after = collectgarbage("count")
+collectgarbage("restart")
+local per = (after - before) * 1024 / N
+print("bytes per instance (24 fields) mem:", per)
+assert(per < 24 * 64, "instance fields should not cost a userdata each")
+local o = objs[N]
+o.f12 = 100
+assert(o.sum() == 1 + 100 + 24 and objs[1].sum() == 1 + 12 + 24)
+local f = objlua.getDeclaredFields(Wide)[12]
+assert(objlua.getFieldValue(f, o) == 100 and objlua.getFieldValue(f, objs[1]) == 12)
+objlua.setFieldValue(f, 7, o)
+assert(o.f12 == 7 and objs[1].f12 == 12)
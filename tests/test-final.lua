@@ -0,0 +1,34 @@
+--@final类不能继承，@final方法子类不能覆盖，调用时直接绑定到方法
+@final class Leaf{
+    private n = 1;
+    public Leaf(n){ self.n = n }
+    get() -> self.n
+    private twice() -> self.n * 2
+    call() -> self.twice()
+}
+local l = Leaf(5)
+for i = 1, 3 do assert(l.get() == 5 and l.call() == 10) end
+assert(not pcall(function() return l.twice() end))
+assert(objlua.isFinal(Leaf) and objlua.isFinal(l))
+local ok, err = pcall(load("class Sub: Leaf {}"))
+assert(not ok and err:find("final"))
+
+class Base{
+    @final id() -> "base"
+    @abstract name(a:number);
+    echo(x) -> x
+}
+class Impl: Base{
+    @final name(a:number) -> "impl"
+    echo(x) -> x .. "!"
+}
+local o = Impl()
+assert(o.id() == "base" and o.name(1) == "impl" and o.echo("a") == "a!")
+assert(not objlua.isFinal(Impl))
+ok, err = pcall(load("class Bad: Base { name(a:number) -> 1 id() -> 2 }"))
+assert(not ok and err:find("final"))
+ok = pcall(load("class Bad2: Impl { name(a:number) -> 1 }"))
+assert(not ok)
+assert(not load("class X { @final x = 1; }"))
+assert(not load("class X { @final @abstract f(); }"))
+print("test-final.lua", "ok")
@@ -0,0 +1,34 @@
+--大量存活对象时增量GC单步（包括原子阶段）的最长停顿不应该随对象数增长
+class Node{
+    public value = 0;
+    public Node(v){ self.value = v }
+}
+local function maxstep(n)
+    --分块存放，避免单个大表的遍历成为最长的一步
+    local live = {}
+    for i = 0, n - 1 do
+        local chunk = live[i // 100 + 1]
+        if not chunk then
+            chunk = {}
+            live[i // 100 + 1] = chunk
+        end
+        chunk[i % 100 + 1] = Node(i)
+    end
+    collectgarbage("collect")
+    --步长调到最小（2KB），最长的一步就是原子阶段
+    collectgarbage("incremental", 200, 100, 1)
+    local worst = 0
+    repeat
+        local t = os.clock()
+        local done = collectgarbage("step", 0)
+        local dt = os.clock() - t
+        if dt > worst then worst = dt end
+    until done
+    return worst * 1000, live
+end
+local small = maxstep(10000)
+local large = maxstep(200000)
+collectgarbage("incremental", 200, 100, 13)
+print("gc worst step ms (10k objects) time:", small)
+print("gc worst step ms (200k objects) time:", large)
+assert(large < small * 5 + 2, "atomic GC pause should not grow with the number of live objects")
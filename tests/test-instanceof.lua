@@ -4,3 +4,18 @@ local class C{}
 local b= B()
 print(b instanceof A, b instanceof B, b instanceof C)
 print(b instanceof A(), b instanceof B(), b instanceof C())
+--祖先表：类对类、对象对自己/父层视图，不同对象之间不算
+local class D:B{
+    public up(){ return super }
+}
+local d, d2 = D(), D()
+assert(D instanceof A and D instanceof B and not (A instanceof D) and not (D instanceof C))
+assert(d instanceof d and d instanceof d.up() and not (d instanceof d2) and not (d.up() instanceof d))
+assert(not (D instanceof d) and not (1 instanceof A) and not (d instanceof 1))
+--typeof的类型名是驻留好的短字符串
+local names = {[1] = "number", [true] = "boolean", x = "string", [print] = "function"}
+for v, name in pairs(names) do
+    assert(v typeof name and not (v typeof "table"))
+end
+assert({} typeof "table" and d typeof "userdata" and coroutine.create(print) typeof "thread")
+assert(not ("x" typeof ("string" .. string.rep(" ", 50))) and not (1 typeof 1))
@@ -0,0 +1,76 @@
+--@memo方法按参数缓存结果，每个对象/类各自一份，objlua.clearMemo扔掉
+local runs = 0
+class Price{
+    private rate = 2;
+    public Price(rate){ self.rate = rate }
+    @memo calc(a, b){ runs = runs + 1; return a * self.rate + (b or 0), "x" }
+    @memo static cfg(k){ runs = runs + 1; return k .. "!" }
+    @memo nothing(){ runs = runs + 1 }
+    setRate(r){ self.rate = r }
+}
+local p, q = Price(2), Price(3)
+for i = 1, 3 do
+    local v, s = p.calc(1, 2)
+    assert(v == 4 and s == "x")
+end
+assert(runs == 1)
+assert(q.calc(1, 2) == 5 and runs == 2)
+assert(p.calc(1) == 2 and runs == 3)
+assert(select('#', p.calc(1, 2)) == 2 and select('#', p.nothing()) == 0 and select('#', p.nothing()) == 0)
+assert(runs == 4)
+p.calc(5, nil); p.calc(5, nil)
+assert(runs == 6) --参数有nil的不缓存
+assert(Price.cfg("a") == "a!" and Price.cfg("a") == "a!" and runs == 7)
+--结果只和参数有关，状态变了要手动清
+p.setRate(10)
+assert(p.calc(1, 2) == 4)
+objlua.clearMemo(p)
+assert(p.calc(1, 2) == 12 and q.calc(1, 2) == 5 and runs == 8)
+objlua.clearMemo(Price)
+assert(q.calc(1, 2) == 5 and Price.cfg("a") == "a!" and runs == 10)
+--从C里调用、尾调用、协程里让出
+assert(select(2, pcall(p.calc, 1, 2)) == 12 and runs == 11)
+assert(select(2, pcall(p.calc, 1, 2)) == 12 and runs == 11)
+local function tail(o) return o.calc(7, 0) end
+assert(tail(p) == 70 and tail(p) == 70 and runs == 12)
+class Y{
+    @memo get(k){ coroutine.yield(k); return k * 2 }
+}
+local y = Y()
+local co = coroutine.wrap(function() return y.get(5) end)
+assert(co() == 5 and co() == 10)
+assert(y.get(5) == 10)
+--有上限，超过就整个重建
+for i = 1, 200 do p.calc(i, 0) end
+runs = 0
+p.calc(200, 0); p.calc(1, 0)
+assert(runs == 1)
+--缓存跟着对象一起回收
+class S{ @memo me(x) -> self }
+local weak = setmetatable({}, {__mode = "k"})
+do local s = S(); assert(s.me(s) == s); weak[s] = true end
+collectgarbage(); collectgarbage()
+assert(next(weak) == nil)
+assert(objlua.isMemo(objlua.getDeclaredMethods(Y)[1]))
+assert(not load("class X { @memo x = 1; }"))
+assert(not load("class X { @memo X(){} }"))
+--1和1.0是不同的参数，结果分开缓存
+class T{
+    @memo kind(x){ runs = runs + 1; return math.type(x) }
+    @memo pair(x, y){ runs = runs + 1; return math.type(x) .. math.type(y) }
+}
+local t = T()
+runs = 0
+assert(t.kind(1) == "integer" and t.kind(1.0) == "float" and t.kind(1) == "integer" and t.kind(1.0) == "float")
+assert(t.pair(2, 2.0) == "integerfloat" and t.pair(2.0, 2) == "floatinteger" and t.pair(2, 2.0) == "integerfloat")
+assert(runs == 4)
+assert(t.kind(-0.0) == "float" and t.kind(-0.0) == "float" and runs == 6) --(-0.0)不缓存
+--命中缓存时钩子也能看到调用和返回
+local kind, seen = t.kind, {}
+debug.sethook(function(ev)
+    if debug.getinfo(2, "f").func == kind then seen[ev] = true end
+end, "cr")
+local r = kind(1)
+debug.sethook()
+assert(r == "integer" and runs == 6 and seen.call and seen["return"])
+print("test-memo.lua", "ok")
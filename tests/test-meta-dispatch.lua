@@ -0,0 +1,24 @@
+--元方法由luaD_precall直接换成Lua帧：接收者在左在右、一元、比较、重载按参数类型选
+class V{
+    private x = 0;
+    public V(x){ self.x = x }
+    @meta __add(o){ return self.x + (type(o) == "number" and o or 0) }
+    @meta __sub(o:number){ return "number" }
+    @meta __sub(o:string){ return "string" }
+    @meta __unm(){ return -self.x }
+    @meta __lt(o){ return self.x < 10 }
+    @meta __concat(o){ return "V" .. self.x }
+}
+local v = V(3)
+assert(v + 1 == 4 and 1 + v == 3 and -v == -3)
+for i = 1, 3 do
+    assert(v - 1 == "number" and v - "a" == "string")
+end
+assert(not pcall(function() return v - {} end))
+assert((v < v) == true and v .. "!" == "V3")
+local add = getmetatable(v).__add
+assert(add(v, 2) == 5)
+assert(not pcall(add, 1, 2))
+local function deep(n) if n == 0 then return 0 end return (v + 0) + deep(n - 1) end
+assert(deep(150) == 450)
+print("test-meta-dispatch.lua", "ok")
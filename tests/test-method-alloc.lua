@@ -0,0 +1,37 @@
+--方法调用稳态不应该再分配内存（代理函数由__index缓存复用）
+class Base{
+    public base(x){
+        return x + 1
+    }
+    public static sbase(x){
+        return x * 2
+    }
+}
+class Counter:Base{
+    private n = 0;
+    public Counter(){};
+    private step(x){
+        return x
+    }
+    public add(x){
+        self.n = self.n + self.step(x)
+        return super.base(self.n)
+    }
+}
+local c = Counter()
+local function run(times)
+    for i = 1, times do
+        c.add(1)
+        c.base(i)
+        Counter.sbase(i)
+    end
+end
+collectgarbage("collect")
+collectgarbage("stop")
+run(10)--预热：第一次访问会建立绑定缓存，collect收缩掉的CallInfo/栈也在这里重新分配
+local before = collectgarbage("count")
+run(10000)
+local after = collectgarbage("count")
+collectgarbage("restart")
+print("method call alloc:", after - before)
+assert(after - before == 0, "steady-state method calls should not allocate")
@@ -0,0 +1,27 @@
+--只有一个带类型限制的方法也有解析缓存，不同类型的参数交替调用结果不能串
+class A{}
+class B{}
+class T{
+    static one(a:number) -> "number"
+    static cls(o:<A>) -> "A"
+    static two(a:number, b) -> b
+}
+--只有一个带类型限制的构造函数
+class C{
+    public v = 0;
+    public C(a:number){ self.v = a }
+}
+local a, b = A(), B()
+for i = 1, 20 do
+    assert(T.one(i) == "number" and T.one(i + 0.5) == "number")
+    assert(not pcall(T.one, "s"))
+    assert(not pcall(T.one, {}))
+    assert(T.cls(a) == "A")
+    assert(not pcall(T.cls, b))
+    assert(T.two(i, "x") == "x" and T.two(i, i) == i)
+    assert(not pcall(T.two, "s", 1))
+    assert(C(i).v == i)
+    assert(not pcall(C, "s"))
+    assert(not pcall(C, a))
+end
+print("test-overload-cache.lua", "ok")
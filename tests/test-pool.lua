@@ -0,0 +1,48 @@
+--开启对象池的类，回收或者release的对象在下次new时复用，字段照常初始化
+local inits = 0
+class Msg{
+    public id = 0;
+    public body = (function() inits = inits + 1 return {} end)();
+    public const tag;
+    public Msg(id){ self.id = id; self.tag = "m" .. id }
+    @meta __gc(){ gcs = (gcs or 0) + 1 }
+}
+class Urgent:Msg{
+    public level = 1;
+}
+objlua.pool(Msg, 4)
+--显式释放
+local a = Msg(1)
+a.body.x = 1
+assert(objlua.release(a) == true and objlua.release(a) == false)
+local b = Msg(2)
+assert(rawequal(a, b), "released object should be reused")
+assert(b.id == 2 and b.tag == "m2" and b.body.x == nil)
+--不是这个类的对象（子类）不进池
+assert(objlua.release(Urgent(3)) == false)
+--被GC回收的对象同样回到池里，类自己的__gc照常执行
+local seen = {}
+for i = 1, 10 do seen[tostring(Msg(i))] = true end
+collectgarbage() collectgarbage()
+assert(gcs >= 10)
+local reused = 0
+for i = 1, 4 do
+    local m = Msg(100 + i)
+    if seen[tostring(m)] then reused = reused + 1 end
+    assert(m.id == 100 + i and m.tag == "m" .. (100 + i) and next(m.body) == nil)
+end
+assert(reused == 4, "collected objects should come back from the pool")
+--稳定的创建/丢弃不应该再持续分配对象
+collectgarbage() collectgarbage()
+local before = inits
+local addrs = {}
+for i = 1, 2000 do
+    local m = Msg(i)
+    addrs[tostring(m)] = true
+    if i % 100 == 0 then collectgarbage() end
+end
+local n = 0
+for _ in pairs(addrs) do n = n + 1 end
+assert(inits - before == 2000 and n < 2000)
+objlua.pool(Msg, 0)
+assert(objlua.release(Msg(0)) == false)
@@ -0,0 +1,31 @@
+--类内访问在方法帧开始时定好：直接调用/构造函数/元方法/字段初始化/热更新都一样，尾调用出去的普通函数没有
+local function peek(o) return o.p end
+class A{
+    private p = 1;
+    private A(){ self.p = 2 }
+    public got = self.p;
+    public get(){ return self.p }
+    public other(o){ return o.p }
+    public leak(){ local v = peek(self) return v }
+    public tailleak(){ return peek(self) }
+    public hot(){ return 0 }
+    static make(){ return A() }
+    @meta __add(o){ return self.p + o.p }
+    @meta __unm(){ return -self.p }
+}
+assert(not pcall(function() return A() end))
+local a = A.make()
+local a2 = A.make()
+assert(a.get() == 2 and a.got == 1 and a.other(a2) == 2 and a + a2 == 4 and -a == -2)
+assert(not pcall(function() return a.p end))
+assert(not pcall(a.leak) and not pcall(a.tailleak))
+for _, m in ipairs(objlua.getDeclaredMethods(A)) do
+    if objlua.getName(m) == "hot" then
+        objlua.hotfixMethod(m, function(self, super)
+            self, super = objlua.getMethodInit()
+            return self.p + 1
+        end)
+    end
+end
+assert(a.hot() == 3)
+print("test-private-access.lua", "ok")
@@ -0,0 +1,31 @@
+--方法里self.字段按编译期槽位直接读写：子类对象/私有/const/self被改掉/接收者换了类都要和普通访问一致
+class A{
+    public x = 1;
+    private y = 2;
+    public const k = 7;
+    public sum(){ return self.x + self.y + self.k }
+    public bump(n){ self.x = self.x + n; self.y = self.y * 2 }
+    public setk(){ self.k = 0 }
+    public other(o){ self = o; return self.x }
+    public swap(t){ self = t; self.x = 9; return self.x }
+}
+class B:A{
+    public z = 3;
+    public x2(){ return self.z + self.sum() }
+}
+class C{
+    public w = 0;
+    public x = 100;
+}
+local a, b = A(), B()
+assert(a.sum() == 10 and b.sum() == 10 and b.x2() == 13)
+for i = 1, 3 do a.bump(1); b.bump(2) end
+assert(a.x == 4 and b.x == 7 and a.sum() == 4 + 16 + 7 and b.sum() == 7 + 16 + 7)
+assert(not pcall(function() a.setk() end) and a.k == 7)
+assert(not pcall(function() return a.y end))
+--接收者换成别的类/普通表时按名字取
+assert(a.other(b) == 7 and a.other(C()) == 100 and a.other({x = 5}) == 5)
+local t = {}
+assert(a.swap(t) == 9 and t.x == 9)
+assert(a.other(a) == 4)
+print("test-self-slot.lua", "ok")
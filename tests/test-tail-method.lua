@@ -0,0 +1,17 @@
+--方法调用在尾部时复用调用方的帧，self/super换成被调方法的，递归多深都不会爆C栈
+class Node{
+    private n = 0;
+    public count(k){ if k == 0 then return self.n end self.n = self.n + 1 return self.count(k - 1) }
+    private hop(k, other){ if k == 0 then return self end return other.hop(k - 1, self) }
+    public pingpong(k, other){ return self.hop(k, other) }
+    public depth(){ return debug.getinfo(1, "t").istailcall }
+}
+class Sub:Node{
+    public up(){ return super.depth() }
+}
+local a, b = Node(), Node()
+assert(a.count(1000000) == 1000000)
+assert(a.pingpong(100001, b) == b and a.pingpong(100000, b) == a)
+local s = Sub()
+assert(s.up() == true)
+print("test-tail-method.lua", "ok")
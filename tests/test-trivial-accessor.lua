@@ -0,0 +1,46 @@
+--只读写一个self.字段的方法调用时直接按槽位读写，不压Lua帧
+class Base{
+    private tag = "base";
+    public Base(){}
+    getTag() -> self.tag
+}
+class P: Base{
+    private name = "a";
+    const id = 7;
+    public P(){}
+    getName() -> self.name
+    setName(v) { self.name = v }
+    getId() { return self.id }
+}
+local p, q = P(), P()
+for i = 1, 3 do
+    p.setName(i)
+    assert(p.getName() == i and q.getName() == "a" and p.getId() == 7 and p.getTag() == "base")
+end
+assert(select('#', p.setName("x")) == 0 and select('#', p.getName(1, 2)) == 1)
+p.setName()
+assert(p.getName() == nil)
+local a, b = p.getId()
+assert(a == 7 and b == nil)
+local function tail(o) return o.getName() end
+q.setName("t")
+assert(tail(q) == "t" and tail(q) == "t")
+assert(not pcall(function() return P.getName() end))
+--热修复之后按新函数走
+local m
+for _, f in ipairs(objlua.getDeclaredMethods(P)) do
+    if objlua.getName(f) == "getName" then m = f end
+end
+local orig = objlua.getMethodFunction(m)
+assert(objlua.hotfixMethod(m, function(self, super) return "fixed" end))
+assert(p.getName() == "fixed" and q.getName() == "fixed")
+p.setName("y")
+assert(p.getName() == "fixed")
+assert(objlua.hotfixMethod(m, orig) and p.getName() == "y")
+--钩子要看到每次调用
+local calls = 0
+debug.sethook(function() calls = calls + 1 end, "c")
+p.getTag()
+debug.sethook()
+assert(calls >= 1)
+print("test-trivial-accessor.lua", "ok")
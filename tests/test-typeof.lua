@@ -21,4 +21,19 @@ a=A()
 print(a typeof A)
 print(a typeof B)
 print(a typeof A())
-print(a typeof B())
\ No newline at end of file
+print(a typeof B())--右边是字面量类型名时编译成OP_TESTTYPE，not/and/or/条件里都要和OP_TYPEOF一样
+local function check(v)
+    if not (v typeof "number") then return "not number" end
+    return v typeof "number" and not (v typeof "string") and "number"
+end
+assert(check(1) == "number" and check("1") == "not number")
+local n = nil
+assert(n typeof "nil" and not (n typeof "foo") and not (1 typeof "no value"))
+assert((a typeof "userdata") == true and (A typeof "userdata") == true and not (a typeof "table"))
+local T <const> = "table"
+assert({} typeof T and (print typeof "function" or false) and not ({} typeof "function" and true))
+local t = {x = 1}
+assert(t.x typeof "number" and (t.y typeof "nil") == true)
+local k = 0
+for _, v in ipairs({1, "a", {}, 2.5, true}) do if v typeof "number" then k = k + 1 end end
+assert(k == 2)
@@ -0,0 +1,34 @@
+--方法、构造函数、字段初始化、元方法里都可以让出
+local y = coroutine.yield
+class A{
+    public log = {};
+    public a = y("init A");
+    public A(n){ self.log[#self.log + 1] = y("ctor A") .. n }
+    public get(){ return y("get") }
+    public tail(){ return self.get() }
+    public slot(t){ self = t; local v = self.log; self.log = v .. "!"; return self.log }
+}
+class B:A{
+    @meta __add(o){ return y("add") + o }
+    public b = y("init B");
+    public B(n){ self.log[#self.log + 1] = y("ctor B") .. n }
+}
+local co = coroutine.wrap(function(n)
+    local b = B(n)
+    local r = b.get()
+    local t = setmetatable({}, {__index = function(_, k) return y("index " .. k) end,
+                                __newindex = function(_, k, v) rawset(_, k, y("newindex " .. v)) end})
+    return b, r, b.tail(), b + 1, b.slot(t)
+end)
+local seen = {}
+local r = table.pack(co(7))
+while type(r[1]) == "string" do
+    seen[#seen + 1] = r[1]
+    r = table.pack(co(#seen))
+end
+assert(table.concat(seen, ",") ==
+        "init A,ctor A,init B,ctor B,get,get,add,index log,newindex 8!")
+local b = r[1]
+assert(b.a == 1 and b.log[1] == "27" and b.b == 3 and b.log[2] == "47")
+assert(r[2] == 5 and r[3] == 6 and r[4] == 8 and r[5] == 9)
+print("test-yield-method.lua", "ok")